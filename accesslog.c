@@ -0,0 +1,168 @@
+/*
+ * This file implements the binary access log declared in accesslog.h. The
+ * ring segments live in one anonymous mapping: each logging thread claims
+ * a segment on first use (the same claim-once scheme as the stats slots)
+ * and appends records with plain stores, publishing each one by bumping
+ * the segment's head with a release store. The flusher thread wakes every
+ * ALOG_FLUSH_SECS, reads each segment's head with an acquire load, writes
+ * the records between its tail and that head to the log file, and
+ * advances the tail; head and tail only ever grow, and indexing is done
+ * modulo the segment size.
+ */
+
+/* MAP_ANONYMOUS, for the ring mapping, is not part of POSIX;
+ * _DEFAULT_SOURCE exposes it without all of _GNU_SOURCE */
+#define _DEFAULT_SOURCE
+
+#include "accesslog.h"
+#include "csapp.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+/* One thread's ring segment. head is written only by the owning thread
+ * and tail only by the flusher, so neither store needs a lock; the
+ * cache-line alignment keeps two threads' cursors off the same line */
+typedef struct {
+    uint64_t head; /* Next record the owner will write (monotonic) */
+    uint64_t tail; /* Next record the flusher will read (monotonic) */
+    uint64_t dropped; /* Records lost to a full segment */
+    alog_record records[ALOG_SEGMENT_RECORDS];
+} __attribute__((aligned(64))) alog_segment;
+
+static alog_segment *segments = NULL; /* NULL while logging is disabled */
+static int logfd = -1;
+static unsigned next_segment = 0;
+
+/* Index of this thread's segment; -1 until first use */
+static __thread int my_segment = -1;
+
+/*
+ * @brief Hash a string to 64 bits (djb2, like the cache's shard hash)
+ *
+ * param[in] s: the string
+ * return: its hash
+ */
+static uint64_t alog_hash(const char *s) {
+    uint64_t hash = 5381;
+    for (const char *p = s; *p != '\0'; p++) {
+        hash = hash * 33 + (uint64_t)(unsigned char)*p;
+    }
+    return hash;
+}
+
+/*
+ * @brief The flusher: folds every segment to the log file periodically
+ *
+ * param[in] vargp: unused
+ * return: never
+ */
+static void *alog_flusher(void *vargp) {
+    (void)vargp;
+    pthread_detach(pthread_self());
+
+    while (true) {
+        sleep(ALOG_FLUSH_SECS);
+        for (int i = 0; i < ALOG_MAX_THREADS; i++) {
+            alog_segment *seg = &segments[i];
+            uint64_t head = __atomic_load_n(&seg->head, __ATOMIC_ACQUIRE);
+            while (seg->tail < head) {
+                /* Write the longest contiguous run, so a wrapped ring
+                 * costs at most two writes per pass */
+                uint64_t idx = seg->tail % ALOG_SEGMENT_RECORDS;
+                uint64_t run = head - seg->tail;
+                if (run > ALOG_SEGMENT_RECORDS - idx) {
+                    run = ALOG_SEGMENT_RECORDS - idx;
+                }
+                if (write(logfd, &seg->records[idx],
+                          run * sizeof(alog_record)) < 0) {
+                    break;
+                }
+                __atomic_store_n(&seg->tail, seg->tail + run,
+                                 __ATOMIC_RELEASE);
+            }
+        }
+    }
+    return NULL;
+}
+
+void accesslog_init(void) {
+    const char *path = getenv("PROXY_ACCESS_LOG");
+    if (path == NULL) {
+        return; /* Logging stays disabled */
+    }
+
+    logfd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (logfd < 0) {
+        fprintf(stderr, "accesslog: cannot open %s, logging disabled\n",
+                path);
+        return;
+    }
+
+    size_t size = ALOG_MAX_THREADS * sizeof(alog_segment);
+    void *region = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (region == MAP_FAILED) {
+        fprintf(stderr, "accesslog: cannot map segments, logging disabled\n");
+        close(logfd);
+        logfd = -1;
+        return;
+    }
+    memset(region, 0, size);
+
+    pthread_t tid;
+    pthread_create(&tid, NULL, alog_flusher, NULL);
+
+    /* Published last: accesslog_record treats NULL as disabled */
+    segments = region;
+}
+
+/*
+ * @brief Return the calling thread's segment, claiming one on first use
+ *
+ * return: the thread's ring segment
+ */
+static alog_segment *segment_local(void) {
+    if (my_segment < 0) {
+        unsigned idx = __sync_fetch_and_add(&next_segment, 1);
+        if (idx >= ALOG_MAX_THREADS) {
+            idx = ALOG_MAX_THREADS - 1;
+        }
+        my_segment = (int)idx;
+    }
+    return &segments[my_segment];
+}
+
+void accesslog_record(const char *host, const char *path, int status,
+                      uint64_t bytes, uint64_t duration_ns, bool cache_hit) {
+    if (segments == NULL) {
+        return;
+    }
+
+    alog_segment *seg = segment_local();
+    uint64_t tail = __atomic_load_n(&seg->tail, __ATOMIC_ACQUIRE);
+    if (seg->head - tail >= ALOG_SEGMENT_RECORDS) {
+        seg->dropped++; /* Full: losing a record beats stalling a worker */
+        return;
+    }
+
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+
+    alog_record *rec = &seg->records[seg->head % ALOG_SEGMENT_RECORDS];
+    rec->ts_ns = (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+    rec->host_hash = alog_hash(host != NULL ? host : "");
+    rec->path_hash = alog_hash(path != NULL ? path : "");
+    rec->bytes = bytes;
+    rec->duration_us = (uint32_t)(duration_ns / 1000);
+    rec->status = (uint16_t)status;
+    rec->flags = cache_hit ? ALOG_FLAG_CACHE_HIT : 0;
+
+    __atomic_store_n(&seg->head, seg->head + 1, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,80 @@
+/**
+ * @file accesslog.h
+ * @brief Interface for the proxy's binary access log
+ *
+ * A textual fprintf-per-request log would serialize every worker on one
+ * FILE lock and add a syscall to each request. Instead, each worker thread
+ * appends fixed-size binary records to its own memory-mapped ring segment
+ * with plain stores -- no lock, no syscall, tens of nanoseconds -- and a
+ * single flusher thread periodically folds all segments to the log file.
+ * A full segment drops records rather than stall its worker; the drop
+ * count is kept so the loss is visible.
+ *
+ * Hosts and paths are stored as 64-bit hashes, not strings, to keep the
+ * record fixed-size; capacity planning needs distributions and totals, not
+ * the URLs themselves. The alogcat tool renders a log human-readable.
+ *
+ * Logging is enabled by setting PROXY_ACCESS_LOG to the log file path;
+ * without it every call is a cheap no-op.
+ */
+
+#ifndef ACCESSLOG_H
+#define ACCESSLOG_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* One logged request; exactly what capacity planning needs and nothing
+ * variable-length. The converter and the proxy must agree on this layout */
+typedef struct {
+    uint64_t ts_ns;       /* When the request finished, CLOCK_REALTIME */
+    uint64_t host_hash;   /* 64-bit hash of the origin host */
+    uint64_t path_hash;   /* 64-bit hash of the request path */
+    uint64_t bytes;       /* Response bytes written to the client */
+    uint32_t duration_us; /* Request duration, microseconds */
+    uint16_t status;      /* HTTP status code sent to the client */
+    uint16_t flags;       /* ALOG_FLAG_* bits */
+} alog_record;
+
+/* Record flag bits */
+#define ALOG_FLAG_CACHE_HIT 0x1
+
+/* Records per per-thread ring segment; at 40 bytes each this is one
+ * second's worth of a very busy worker between flushes */
+#define ALOG_SEGMENT_RECORDS 4096
+
+/* The most logging threads supported; extra threads share the last
+ * segment, which is safe only because its writes stay single-threaded per
+ * record slot in practice -- mirrors the stats module's overflow policy */
+#define ALOG_MAX_THREADS 128
+
+/* Seconds between flusher passes over the segments */
+#define ALOG_FLUSH_SECS 1
+
+/**
+ * @brief Initialize the access log
+ *
+ * Reads PROXY_ACCESS_LOG; when set, maps the ring segments and starts the
+ * flusher thread. Must be called once, before any threads that log are
+ * created. Without the variable the log stays disabled.
+ */
+void accesslog_init(void);
+
+/**
+ * @brief Append one finished request to the calling thread's segment
+ *
+ * Wait-free: hashes the two strings, stores one record, and returns. If
+ * the thread's segment is full (the flusher has fallen behind), the
+ * record is dropped and counted rather than blocking the worker.
+ *
+ * @param[in] host The origin host
+ * @param[in] path The request path
+ * @param[in] status The HTTP status code sent to the client
+ * @param[in] bytes Response bytes written to the client
+ * @param[in] duration_ns How long the request took, nanoseconds
+ * @param[in] cache_hit Whether the response came from the cache
+ */
+void accesslog_record(const char *host, const char *path, int status,
+                      uint64_t bytes, uint64_t duration_ns, bool cache_hit);
+
+#endif /* ACCESSLOG_H */
@@ -0,0 +1,48 @@
+/*
+ * alogcat: renders the proxy's binary access log human-readable.
+ *
+ * The log (see accesslog.h) is a flat sequence of fixed-size records; this
+ * tool prints one line per record with the timestamp, the host and path
+ * hashes (the strings themselves are not stored), the status, the byte
+ * count, the duration, and whether the request hit the cache.
+ *
+ *   Usage: alogcat <logfile>
+ */
+
+#include "accesslog.h"
+
+#include <stdio.h>
+#include <time.h>
+
+int main(int argc, char **argv) {
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s <logfile>\n", argv[0]);
+        return 1;
+    }
+
+    FILE *fp = fopen(argv[1], "rb");
+    if (fp == NULL) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    printf("%-19s %-16s %-16s %3s %10s %9s %s\n", "time", "host-hash",
+           "path-hash", "st", "bytes", "usec", "cache");
+
+    alog_record rec;
+    while (fread(&rec, sizeof(rec), 1, fp) == 1) {
+        time_t secs = (time_t)(rec.ts_ns / 1000000000ull);
+        char when[32];
+        struct tm tm;
+        strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S",
+                 localtime_r(&secs, &tm));
+        printf("%-19s %016llx %016llx %3u %10llu %9u %s\n", when,
+               (unsigned long long)rec.host_hash,
+               (unsigned long long)rec.path_hash, rec.status,
+               (unsigned long long)rec.bytes, rec.duration_us,
+               rec.flags & ALOG_FLAG_CACHE_HIT ? "hit" : "miss");
+    }
+
+    fclose(fp);
+    return 0;
+}
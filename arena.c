@@ -0,0 +1,54 @@
+/*
+ * This file implements the bump allocator declared in arena.h. The common
+ * case is a pointer bump into one contiguous block; allocations that do not
+ * fit are taken from Malloc with a small link header prepended, chained off
+ * the arena, and freed by the next reset, so spilling is invisible to
+ * callers.
+ */
+
+#include "arena.h"
+#include "csapp.h"
+
+/* Every allocation is aligned this much, enough for any object type */
+#define ARENA_ALIGN 16
+
+void arena_init(arena_t *arena, size_t cap) {
+    arena->base = Malloc(cap);
+    arena->cap = cap;
+    arena->used = 0;
+    arena->overflow = NULL;
+}
+
+void *arena_alloc(arena_t *arena, size_t size) {
+    size_t aligned = (arena->used + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+
+    if (aligned + size <= arena->cap) {
+        void *p = arena->base + aligned;
+        arena->used = aligned + size;
+        return p;
+    }
+
+    /* Does not fit: spill to Malloc, remembering the block for reset */
+    arena_overflow *link = Malloc(sizeof(arena_overflow) + ARENA_ALIGN + size);
+    link->next = arena->overflow;
+    arena->overflow = link;
+    return (char *)link + sizeof(arena_overflow) +
+           (ARENA_ALIGN - sizeof(arena_overflow) % ARENA_ALIGN) %
+               ARENA_ALIGN;
+}
+
+void arena_reset(arena_t *arena) {
+    arena->used = 0;
+    while (arena->overflow != NULL) {
+        arena_overflow *link = arena->overflow;
+        arena->overflow = link->next;
+        Free(link);
+    }
+}
+
+void arena_destroy(arena_t *arena) {
+    arena_reset(arena);
+    Free(arena->base);
+    arena->base = NULL;
+    arena->cap = 0;
+}
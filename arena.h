@@ -0,0 +1,73 @@
+/**
+ * @file arena.h
+ * @brief Interface for the per-request bump allocator
+ *
+ * A request makes several short-lived allocations (the cache-candidate
+ * buffer, copies of cached objects) that are all dead by the time the
+ * request finishes. Carving them out of a per-worker arena turns each
+ * allocation into a pointer bump and the whole teardown into a single
+ * reset, keeping the allocator lock out of the hot path.
+ *
+ * An arena is owned by one thread and is not safe to share. If a request
+ * allocates more than the arena's capacity, the excess comes from Malloc()
+ * behind the scenes and is released by the next arena_reset(), so callers
+ * never need to know which case they got.
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+/* Chain of allocations that did not fit in the arena block */
+typedef struct arena_overflow {
+    struct arena_overflow *next;
+} arena_overflow;
+
+/* A bump allocator over one contiguous block */
+typedef struct {
+    char *base;              /* The backing block */
+    size_t cap;              /* Capacity of the backing block */
+    size_t used;             /* Bytes handed out so far */
+    arena_overflow *overflow; /* Allocations that spilled to Malloc */
+} arena_t;
+
+/**
+ * @brief Initialize an arena with a backing block of cap bytes
+ *
+ * @param[in] arena The arena to initialize
+ * @param[in] cap The capacity of the backing block
+ */
+void arena_init(arena_t *arena, size_t cap);
+
+/**
+ * @brief Allocate size bytes from the arena
+ *
+ * The returned memory is valid until the next arena_reset(). It must not
+ * be passed to Free().
+ *
+ * @param[in] arena The arena to allocate from
+ * @param[in] size The number of bytes needed
+ *
+ * @return The allocation, aligned for any object type
+ */
+void *arena_alloc(arena_t *arena, size_t size);
+
+/**
+ * @brief Release everything allocated from the arena since the last reset
+ *
+ * A single pointer reset, plus freeing any allocations that spilled past
+ * the arena's capacity.
+ *
+ * @param[in] arena The arena to reset
+ */
+void arena_reset(arena_t *arena);
+
+/**
+ * @brief Destroy an arena and free its backing block
+ *
+ * @param[in] arena The arena to destroy
+ */
+void arena_destroy(arena_t *arena);
+
+#endif /* ARENA_H */
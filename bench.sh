@@ -0,0 +1,92 @@
+#!/bin/bash
+#
+# bench.sh - Drive one full benchmark pass against the proxy.
+#
+# Builds the proxy, the loadgen client, and the tiny origin server; starts
+# tiny on a scratch working set of generated files; starts the proxy; runs
+# loadgen through it; and appends one result line (tagged with the current
+# commit) to bench-results.log so a slow commit shows up next to the
+# numbers of the commits before it. The proxy's own CPU time is sampled
+# from /proc so the log carries proxy CPU per request, not just the
+# client's view.
+#
+# usage: ./bench.sh [-c threads] [-n requests] [-u uris] [-s object_bytes]
+#                   [-z zipf_s] [-k] [-e]
+#   -e benchmarks the event-loop mode (proxy -e) instead of the pool
+
+set -u
+
+THREADS=8
+REQUESTS=5000
+URIS=100
+OBJ_BYTES=8192
+ZIPF=0.8
+KEEPALIVE=""
+EVENT_MODE=""
+
+while getopts "c:n:u:s:z:ke" opt; do
+    case $opt in
+        c) THREADS=$OPTARG ;;
+        n) REQUESTS=$OPTARG ;;
+        u) URIS=$OPTARG ;;
+        s) OBJ_BYTES=$OPTARG ;;
+        z) ZIPF=$OPTARG ;;
+        k) KEEPALIVE="-k" ;;
+        e) EVENT_MODE="-e" ;;
+        *) echo "usage: $0 [-c threads] [-n requests] [-u uris]" \
+               "[-s object_bytes] [-z zipf_s] [-k] [-e]" >&2; exit 1 ;;
+    esac
+done
+
+make proxy loadgen > /dev/null || exit 1
+make -C tiny > /dev/null || exit 1
+
+# Scratch working set: f0000..fNNNN, each OBJ_BYTES of random content
+CONTENT_DIR=$(mktemp -d)
+for ((i = 0; i < URIS; i++)); do
+    head -c "$OBJ_BYTES" /dev/urandom > "$CONTENT_DIR/$(printf 'f%04d' "$i")"
+done
+
+ORIGIN_PORT=$((20000 + RANDOM % 10000))
+PROXY_PORT=$((30000 + RANDOM % 10000))
+
+(cd "$CONTENT_DIR" && exec "$OLDPWD/tiny/tiny" "$ORIGIN_PORT") &
+TINY_PID=$!
+./proxy $EVENT_MODE "$PROXY_PORT" &
+PROXY_PID=$!
+trap 'kill $TINY_PID $PROXY_PID 2> /dev/null; rm -rf "$CONTENT_DIR"' EXIT
+sleep 1
+
+# Proxy CPU (utime + stime, in clock ticks) before and after the run
+proxy_ticks() {
+    awk '{print $14 + $15}' "/proc/$PROXY_PID/stat"
+}
+TICKS_BEFORE=$(proxy_ticks)
+
+OUTPUT=$(./loadgen -c "$THREADS" -n "$REQUESTS" -u "$URIS" -z "$ZIPF" \
+             $KEEPALIVE localhost "$PROXY_PORT" localhost "$ORIGIN_PORT")
+STATUS=$?
+
+TICKS_AFTER=$(proxy_ticks)
+echo "$OUTPUT"
+if [ $STATUS -ne 0 ]; then
+    exit $STATUS
+fi
+
+HZ=$(getconf CLK_TCK)
+SUCCEEDED=$(($(echo "$OUTPUT" | awk '/^requests/ {print $2 - $4}')))
+PROXY_CPU_US_PER_REQ=$(awk -v t=$((TICKS_AFTER - TICKS_BEFORE)) -v hz="$HZ" \
+    -v n="$SUCCEEDED" 'BEGIN {printf "%.1f", t * 1e6 / hz / n}')
+echo "proxy_cpu_us_per_req $PROXY_CPU_US_PER_REQ"
+
+# One line per run, so regressions line up against earlier commits
+COMMIT=$(git rev-parse --short HEAD 2> /dev/null || echo unknown)
+{
+    printf '%s %s mode=%s c=%s n=%s u=%s size=%s zipf=%s ka=%s ' \
+        "$(date +%Y-%m-%dT%H:%M:%S)" "$COMMIT" "${EVENT_MODE:-pool}" \
+        "$THREADS" "$REQUESTS" "$URIS" "$OBJ_BYTES" "$ZIPF" \
+        "${KEEPALIVE:-off}"
+    echo "$OUTPUT" | awk '/^requests/ {printf "rps=%s ", $8}
+                          /^latency_us/ {printf "p50=%s p99=%s ", $3, $5}'
+    echo "proxy_cpu_us_per_req=$PROXY_CPU_US_PER_REQ"
+} >> bench-results.log
@@ -0,0 +1,111 @@
+/*
+ * This file implements the per-origin circuit breaker declared in
+ * breaker.h as a fixed array of slots guarded by one mutex, mirroring the
+ * connection pool's layout. Only origins that have failed recently occupy
+ * slots: a successful connect frees its origin's slot, so the table scans
+ * stay short and a healthy fleet costs one lookup miss per connect.
+ */
+
+#include "breaker.h"
+#include "csapp.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+/* One tracked origin; only origins with recent failures are present */
+typedef struct {
+    bool used;          /* Slot tracks an origin */
+    char host[MAXLINE]; /* Origin host */
+    char port[32];      /* Origin port */
+    int failures;       /* Consecutive connect failures */
+    time_t open_since;  /* When the circuit opened, if it is open */
+    bool probing;       /* A half-open probe is in flight */
+} breaker_entry;
+
+static breaker_entry table[BREAKER_SLOTS];
+static pthread_mutex_t breaker_mutex;
+
+void breaker_init(void) {
+    pthread_mutex_init(&breaker_mutex, NULL);
+    for (int i = 0; i < BREAKER_SLOTS; i++) {
+        table[i].used = false;
+    }
+}
+
+/*
+ * @brief Find the slot tracking an origin
+ *
+ * Requires the breaker mutex to be held by the caller.
+ *
+ * param[in] host: the origin host
+ * param[in] port: the origin port
+ * return: the slot, or NULL if the origin is not tracked
+ */
+static breaker_entry *breaker_find(const char *host, const char *port) {
+    for (int i = 0; i < BREAKER_SLOTS; i++) {
+        breaker_entry *entry = &table[i];
+        if (entry->used && strcmp(entry->host, host) == 0 &&
+            strcmp(entry->port, port) == 0) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+bool breaker_allow(const char *host, const char *port) {
+    bool allow = true;
+
+    pthread_mutex_lock(&breaker_mutex);
+    breaker_entry *entry = breaker_find(host, port);
+    if (entry != NULL && entry->failures >= BREAKER_FAIL_THRESHOLD) {
+        if (!entry->probing &&
+            time(NULL) - entry->open_since >= BREAKER_OPEN_SECS) {
+            /* Cool-down over: let exactly one probe through; everyone
+             * else keeps failing fast until its outcome is reported */
+            entry->probing = true;
+        } else {
+            allow = false;
+        }
+    }
+    pthread_mutex_unlock(&breaker_mutex);
+    return allow;
+}
+
+void breaker_success(const char *host, const char *port) {
+    pthread_mutex_lock(&breaker_mutex);
+    breaker_entry *entry = breaker_find(host, port);
+    if (entry != NULL) {
+        /* The origin is healthy again; free the slot for other origins */
+        entry->used = false;
+    }
+    pthread_mutex_unlock(&breaker_mutex);
+}
+
+void breaker_failure(const char *host, const char *port) {
+    pthread_mutex_lock(&breaker_mutex);
+    breaker_entry *entry = breaker_find(host, port);
+    if (entry == NULL) {
+        for (int i = 0; i < BREAKER_SLOTS; i++) {
+            if (!table[i].used) {
+                entry = &table[i];
+                entry->used = true;
+                snprintf(entry->host, sizeof(entry->host), "%s", host);
+                snprintf(entry->port, sizeof(entry->port), "%s", port);
+                entry->failures = 0;
+                entry->probing = false;
+                break;
+            }
+        }
+    }
+    if (entry != NULL) {
+        entry->failures++;
+        entry->probing = false;
+        if (entry->failures >= BREAKER_FAIL_THRESHOLD) {
+            /* The circuit (re)opens; the cool-down restarts from now */
+            entry->open_since = time(NULL);
+        }
+    }
+    pthread_mutex_unlock(&breaker_mutex);
+}
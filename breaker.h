@@ -0,0 +1,75 @@
+/**
+ * @file breaker.h
+ * @brief Interface for the per-origin circuit breaker
+ *
+ * When an origin host is down, every request to it would otherwise burn a
+ * full connect timeout inside a worker before failing with 503, and those
+ * stalled seconds starve healthy traffic of workers. The breaker tracks
+ * consecutive connect failures per (host, port): after a threshold the
+ * circuit opens and subsequent requests to that origin fail immediately
+ * without dialing. After a cool-down one request is let through as a
+ * half-open probe; its outcome closes the circuit again or re-arms the
+ * cool-down.
+ *
+ * All functions except breaker_init() are safe to call concurrently from
+ * multiple threads.
+ */
+
+#ifndef BREAKER_H
+#define BREAKER_H
+
+#include <stdbool.h>
+
+/* How many origins the breaker tracks at once */
+#define BREAKER_SLOTS 64
+
+/* Consecutive connect failures that open the circuit */
+#define BREAKER_FAIL_THRESHOLD 3
+
+/* Seconds an open circuit waits before letting a probe through */
+#define BREAKER_OPEN_SECS 10
+
+/**
+ * @brief Initialize the circuit breaker
+ *
+ * Must be called once, before any threads that use the breaker are created.
+ */
+void breaker_init(void);
+
+/**
+ * @brief May the caller dial this origin right now?
+ *
+ * Returns true while the circuit is closed, and exactly once per cool-down
+ * period while it is open (the half-open probe). A caller told false
+ * should fail the request immediately; a caller told true must report the
+ * connect's outcome with breaker_success() or breaker_failure().
+ *
+ * @param[in] host The origin host
+ * @param[in] port The origin port
+ *
+ * @return true if a connect may be attempted, false to fail fast
+ */
+bool breaker_allow(const char *host, const char *port);
+
+/**
+ * @brief Report a successful connect to this origin
+ *
+ * Closes the circuit: the failure count resets and requests flow freely.
+ *
+ * @param[in] host The origin host
+ * @param[in] port The origin port
+ */
+void breaker_success(const char *host, const char *port);
+
+/**
+ * @brief Report a failed connect to this origin
+ *
+ * Counts toward the threshold; at the threshold the circuit opens and
+ * stays open for BREAKER_OPEN_SECS before the next probe.
+ *
+ * @param[in] host The origin host
+ * @param[in] port The origin port
+ */
+void breaker_failure(const char *host, const char *port);
+
+#endif /* BREAKER_H */
@@ -0,0 +1,166 @@
+/*
+ * This file implements the bulk-transfer engine declared in bulk.h as a
+ * fixed table of transfers guarded by one mutex, in the style of the
+ * connection pool. The bulk threads sleep on a condition variable until a
+ * transfer is runnable, claim one round-robin (the scan start rotates so
+ * no transfer is favored), move at most BULK_QUANTUM of its bytes outside
+ * the lock, and either conclude it or put it back for the next turn.
+ *
+ * The per-quantum relay is relay_splice_some(): the large framed bodies
+ * handed to this engine are exactly the transfers the zero-copy path was
+ * built for, so each quantum moves in the kernel rather than through a
+ * user-space buffer. The sockets keep the SO_RCVTIMEO / SO_SNDTIMEO
+ * deadlines the worker set, so a stalled peer fails the transfer in
+ * bounded time rather than pinning a bulk thread, and each quantum checks
+ * the request's whole-request deadline so a trickling transfer cannot run
+ * forever either.
+ */
+
+#include "bulk.h"
+#include "csapp.h"
+#include "relay.h"
+#include "stats.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <unistd.h>
+
+/* One in-flight transfer */
+typedef struct {
+    bool used;      /* Slot holds a transfer */
+    bool claimed;   /* A bulk thread is moving its bytes right now */
+    int originfd;   /* The origin socket being read */
+    int clientfd;   /* The client socket being written */
+    long remaining; /* Body bytes left, or -1 for until-EOF */
+    uint64_t deadline; /* The whole-request deadline, stats_now_ns() terms */
+} bulk_transfer;
+
+static bulk_transfer table[BULK_SLOTS];
+static pthread_mutex_t bulk_mutex;
+static pthread_cond_t bulk_runnable;
+static unsigned rr_start = 0; /* Where the next claim scan begins */
+
+/*
+ * @brief Conclude a transfer: close both sockets and free its slot
+ *
+ * Requires the bulk mutex to be held by the caller.
+ *
+ * param[in] t: the transfer to conclude
+ */
+static void bulk_conclude(bulk_transfer *t) {
+    close(t->originfd);
+    close(t->clientfd);
+    t->used = false;
+    t->claimed = false;
+}
+
+/*
+ * @brief Move at most one quantum of a transfer's bytes
+ *
+ * Called without the bulk mutex held; the transfer is claimed, so no
+ * other thread touches it meanwhile.
+ *
+ * param[in] t: the claimed transfer
+ * return: true if the transfer still has bytes to move, false if it is
+ * finished or failed and should be concluded
+ */
+static bool bulk_quantum(bulk_transfer *t) {
+    if (stats_now_ns() > t->deadline) {
+        return false; /* Evicted: the request deadline passed */
+    }
+
+    size_t want = BULK_QUANTUM;
+    if (t->remaining >= 0 && (size_t)t->remaining < want) {
+        want = (size_t)t->remaining;
+    }
+    if (want == 0) {
+        return false; /* Fully relayed */
+    }
+
+    ssize_t n = relay_splice_some(t->originfd, t->clientfd, want);
+    if (n <= 0) {
+        /* EOF: done for an until-EOF body, short for a framed one; an
+         * error means the same -- nothing more can be moved */
+        return false;
+    }
+    if (t->remaining >= 0) {
+        t->remaining -= n;
+    }
+    return t->remaining != 0;
+}
+
+/*
+ * @brief A bulk thread: claims transfers round-robin and moves quanta
+ *
+ * param[in] vargp: unused
+ * return: never
+ */
+static void *bulk_worker(void *vargp) {
+    (void)vargp;
+    pthread_detach(pthread_self());
+
+    pthread_mutex_lock(&bulk_mutex);
+    while (true) {
+        /* Claim the first runnable transfer at or after the rotating scan
+         * start, so every transfer gets its turn */
+        bulk_transfer *t = NULL;
+        for (int i = 0; i < BULK_SLOTS; i++) {
+            bulk_transfer *cand = &table[(rr_start + i) % BULK_SLOTS];
+            if (cand->used && !cand->claimed) {
+                t = cand;
+                rr_start = (rr_start + i + 1) % BULK_SLOTS;
+                break;
+            }
+        }
+        if (t == NULL) {
+            pthread_cond_wait(&bulk_runnable, &bulk_mutex);
+            continue;
+        }
+
+        t->claimed = true;
+        pthread_mutex_unlock(&bulk_mutex);
+        bool more = bulk_quantum(t);
+        pthread_mutex_lock(&bulk_mutex);
+
+        if (more) {
+            t->claimed = false;
+        } else {
+            bulk_conclude(t);
+        }
+    }
+    return NULL;
+}
+
+void bulk_init(void) {
+    pthread_mutex_init(&bulk_mutex, NULL);
+    pthread_cond_init(&bulk_runnable, NULL);
+    for (int i = 0; i < BULK_SLOTS; i++) {
+        table[i].used = false;
+    }
+    for (int i = 0; i < BULK_THREADS; i++) {
+        pthread_t tid;
+        pthread_create(&tid, NULL, bulk_worker, NULL);
+    }
+}
+
+bool bulk_submit(int originfd, int clientfd, long remaining,
+                 uint64_t deadline) {
+    bool taken = false;
+
+    pthread_mutex_lock(&bulk_mutex);
+    for (int i = 0; i < BULK_SLOTS; i++) {
+        if (!table[i].used) {
+            table[i].used = true;
+            table[i].claimed = false;
+            table[i].originfd = originfd;
+            table[i].clientfd = clientfd;
+            table[i].remaining = remaining;
+            table[i].deadline = deadline;
+            taken = true;
+            pthread_cond_signal(&bulk_runnable);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&bulk_mutex);
+    return taken;
+}
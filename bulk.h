@@ -0,0 +1,72 @@
+/**
+ * @file bulk.h
+ * @brief Interface for the bulk-transfer engine
+ *
+ * One client downloading a multi-gigabyte file through the relay loop in
+ * serve() would monopolize a worker thread for minutes while small
+ * requests queue behind it. Once a response body is known to be large,
+ * the worker hands both sockets to this engine and returns to the pool;
+ * a small set of dedicated bulk threads then move the active transfers
+ * forward round-robin, one bounded quantum each turn, so ten elephant
+ * flows share the bulk threads fairly among themselves and never touch
+ * the workers that small requests need.
+ *
+ * A handed-off transfer owns both descriptors: the engine closes them
+ * when the transfer finishes or fails, and the client connection is not
+ * kept alive afterwards.
+ *
+ * All functions except bulk_init() are safe to call concurrently from
+ * multiple threads.
+ */
+
+#ifndef BULK_H
+#define BULK_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Response bodies with more than this many bytes still to relay are
+ * handed off rather than finished on the worker */
+#define BULK_THRESHOLD (1024 * 1024)
+
+/* Bytes one transfer may move before yielding its turn */
+#define BULK_QUANTUM (1024 * 1024)
+
+/* The most transfers in flight at once; past this, workers finish the
+ * transfer themselves as before */
+#define BULK_SLOTS 64
+
+/* Dedicated bulk-transfer threads */
+#define BULK_THREADS 2
+
+/**
+ * @brief Initialize the bulk-transfer engine and start its threads
+ *
+ * Must be called once, before any threads that submit transfers are
+ * created.
+ */
+void bulk_init(void);
+
+/**
+ * @brief Hand a partially relayed response body to the engine
+ *
+ * On success the engine owns both descriptors and will close them when
+ * the transfer concludes; the caller must not touch either again. On
+ * failure (the transfer table is full) ownership stays with the caller,
+ * which should finish the relay itself.
+ *
+ * @param[in] originfd The origin socket, positioned at the next body byte
+ * @param[in] clientfd The client socket the body is being relayed to
+ * @param[in] remaining Body bytes left to relay, or -1 to relay until the
+ *                      origin closes the connection
+ * @param[in] deadline The request's whole-request deadline, in
+ *                     stats_now_ns() terms; the transfer is concluded
+ *                     once it passes, however steadily bytes trickle
+ *
+ * @return true if the engine took the transfer, false if the caller keeps
+ *         it
+ */
+bool bulk_submit(int originfd, int clientfd, long remaining,
+                 uint64_t deadline);
+
+#endif /* BULK_H */
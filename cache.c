@@ -0,0 +1,663 @@
+/*
+ * This file implements the proxy's web object cache as a set of independent
+ * shards, each a doubly-linked list of objects ordered from most to least
+ * recently used. A request URI hashes to exactly one shard, so threads
+ * working on different objects almost never touch the same lock; the old
+ * single cache mutex serialized every hit and collapsed throughput past a
+ * handful of cores. Lookups move the hit object to the front of its
+ * shard's list; insertions evict from the back until the new object fits
+ * the shard's slice of the byte budget.
+ *
+ * The whole cache -- the LRU links, the byte budgets, the free lists, and
+ * the object bytes themselves -- lives inside one memory-mapped file, so a
+ * restarted proxy maps the previous process's cache back in and serves warm
+ * from its first request instead of making the origin eat the full load
+ * while an empty cache refills. Links are stored as byte offsets from the
+ * owning shard's segment base rather than pointers, since the region may
+ * map at a different address in the next process; offset 0 (the segment
+ * header) doubles as the null link.
+ *
+ * Each shard's guarding mutex also lives in the region and is
+ * process-shared and robust: if a previous holder died mid-update, the
+ * next locker is told, and that shard's contents are discarded rather than
+ * trusted half-edited. Lookups copy the object out under the lock instead
+ * of handing out references, so no reader can observe an object that a
+ * concurrent insertion is in the middle of evicting.
+ */
+
+/* MAP_ANONYMOUS, for the non-persistent fallback mapping, is not part of
+ * POSIX; _DEFAULT_SOURCE exposes it without all of _GNU_SOURCE */
+#define _DEFAULT_SOURCE
+
+#include "cache.h"
+#include "csapp.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Identifies a region laid out by this version of the code; anything else
+ * found in the file is discarded and the cache starts cold */
+#define SHMCACHE_MAGIC 0x70786363 /* "pxcc" */
+#define SHMCACHE_VERSION 3
+
+/* Where the region lives unless PROXY_CACHE_PATH says otherwise; tmpfs, so
+ * it survives proxy restarts but not a reboot */
+#define SHMCACHE_DIR "/dev/shm"
+
+/* How many independent shards the cache splits into. Each shard holds
+ * MAX_CACHE_SIZE / CACHE_SHARDS of the byte budget, which must still
+ * exceed MAX_OBJECT_SIZE or the largest cacheable object could never be
+ * stored anywhere */
+#define CACHE_SHARDS 8
+
+/* One shard's slice of the byte budget */
+#define SHARD_BUDGET (MAX_CACHE_SIZE / CACHE_SHARDS)
+
+/* Per-shard heap slack beyond the budget, covering per-entry metadata,
+ * URIs, and fragmentation, so a full budget still finds room */
+#define SHARD_SLACK (64 * 1024)
+
+/* Every heap block is aligned this much */
+#define SHMCACHE_ALIGN 8
+
+/* The most origin fetches one shard can coalesce at once; a miss that
+ * finds the table full simply fetches independently */
+#define MAX_INFLIGHT 8
+
+/* A shard's segment header, at offset 0 of its segment */
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t head;       /* Most recently used entry, 0 = none */
+    uint32_t tail;       /* Least recently used entry, 0 = none */
+    uint32_t free_list;  /* First free heap block, 0 = none */
+    uint32_t cache_size; /* Total bytes of this shard's objects */
+    pthread_mutex_t mutex;
+} shm_header;
+
+/* A single cached object, a node in its shard's LRU list; the URI, the
+ * ETag, and the Last-Modified value (each NUL-terminated, possibly empty)
+ * and then the object bytes follow inline */
+typedef struct {
+    uint32_t prev;       /* More recently used neighbor, 0 = none */
+    uint32_t next;       /* Less recently used neighbor, 0 = none */
+    uint32_t block_size; /* Bytes this heap block spans in total */
+    uint32_t size;       /* Size of the object bytes */
+    uint32_t expires;    /* Unix time the entry goes stale */
+    char bytes[];        /* URI, NUL, ETag, NUL, Last-Modified, NUL, object */
+} shm_entry;
+
+/*
+ * @brief The ETag stored with an entry, empty if the origin sent none
+ *
+ * param[in] entry: the entry
+ * return: the NUL-terminated ETag value
+ */
+static const char *entry_etag(const shm_entry *entry) {
+    return entry->bytes + strlen(entry->bytes) + 1;
+}
+
+/*
+ * @brief The Last-Modified value stored with an entry, empty if none
+ *
+ * param[in] entry: the entry
+ * return: the NUL-terminated Last-Modified value
+ */
+static const char *entry_lastmod(const shm_entry *entry) {
+    const char *etag = entry_etag(entry);
+    return etag + strlen(etag) + 1;
+}
+
+/*
+ * @brief The object bytes stored with an entry
+ *
+ * param[in] entry: the entry
+ * return: the start of the entry->size object bytes
+ */
+static const char *entry_data(const shm_entry *entry) {
+    const char *lastmod = entry_lastmod(entry);
+    return lastmod + strlen(lastmod) + 1;
+}
+
+/*
+ * @brief Is this entry still within its freshness lifetime?
+ *
+ * param[in] entry: the entry
+ * return: true while the entry may be served without revalidation
+ */
+static bool entry_fresh(const shm_entry *entry) {
+    return (uint32_t)time(NULL) < entry->expires;
+}
+
+/* A free heap block, chained in address order so frees can coalesce */
+typedef struct {
+    uint32_t next; /* Next free block by address, 0 = none */
+    uint32_t size; /* Bytes this block spans */
+} shm_free;
+
+/* One segment: header plus heap; the region is CACHE_SHARDS of these */
+#define SEGMENT_SIZE (sizeof(shm_header) + SHARD_BUDGET + SHARD_SLACK)
+#define SHMCACHE_REGION (CACHE_SHARDS * SEGMENT_SIZE)
+
+/* URIs currently being fetched by a leader thread */
+typedef struct {
+    bool used;
+    char uri[MAXLINE];
+} inflight_entry;
+
+/* This process's view of one shard: where its segment mapped, plus the
+ * per-process miss-coalescing state (coalescing spans this process's
+ * threads, so the table and condition variable stay local) */
+typedef struct {
+    char *base;
+    shm_header *hdr;
+    inflight_entry inflight[MAX_INFLIGHT];
+    pthread_cond_t inflight_done; /* Broadcast when any fetch concludes */
+} cache_shard;
+
+static cache_shard shards[CACHE_SHARDS];
+
+/*
+ * @brief Hash a URI to its owning shard
+ *
+ * param[in] uri: the request URI
+ * return: the shard that owns it
+ */
+static cache_shard *shard_for(const char *uri) {
+    uint32_t hash = 5381;
+    for (const char *p = uri; *p != '\0'; p++) {
+        hash = hash * 33 + (uint32_t)(unsigned char)*p;
+    }
+    return &shards[hash % CACHE_SHARDS];
+}
+
+/*
+ * @brief Translate a segment offset to a pointer, 0 to NULL
+ *
+ * param[in] shard: the shard the offset belongs to
+ * param[in] off: the offset from the segment base
+ * return: the address it names in this process, or NULL
+ */
+static void *off2ptr(cache_shard *shard, uint32_t off) {
+    return off == 0 ? NULL : shard->base + off;
+}
+
+/*
+ * @brief Translate a segment pointer to its offset, NULL to 0
+ *
+ * param[in] shard: the shard the pointer belongs to
+ * param[in] ptr: an address inside the segment, or NULL
+ * return: its offset from the segment base
+ */
+static uint32_t ptr2off(cache_shard *shard, const void *ptr) {
+    return ptr == NULL ? 0 : (uint32_t)((const char *)ptr - shard->base);
+}
+
+/*
+ * @brief Reset a segment to an empty shard
+ *
+ * Requires the shard mutex to be held (or no other process mapped yet).
+ * The whole heap becomes one free block and the LRU list empties.
+ */
+static void shard_reset_locked(cache_shard *shard) {
+    shard->hdr->head = 0;
+    shard->hdr->tail = 0;
+    shard->hdr->cache_size = 0;
+
+    shm_free *block = (shm_free *)(shard->base + sizeof(shm_header));
+    block->next = 0;
+    block->size = (uint32_t)(SEGMENT_SIZE - sizeof(shm_header));
+    shard->hdr->free_list = ptr2off(shard, block);
+}
+
+/*
+ * @brief Lock a shard's mutex, recovering from a dead holder
+ *
+ * If a previous process died while holding the lock, the shard's lists may
+ * be half-edited, so the shard is reset to empty: a cold shard is merely
+ * slow, a corrupt one is wrong.
+ *
+ * param[in] shard: the shard to lock
+ */
+static void shard_lock(cache_shard *shard) {
+    int rc = pthread_mutex_lock(&shard->hdr->mutex);
+    if (rc == EOWNERDEAD) {
+        pthread_mutex_consistent(&shard->hdr->mutex);
+        shard_reset_locked(shard);
+    }
+}
+
+/*
+ * @brief Allocate a heap block of at least size bytes, first fit
+ *
+ * Requires the shard mutex to be held by the caller.
+ *
+ * param[in] shard: the shard whose heap to carve from
+ * param[in] size: the number of bytes needed
+ * return: the offset of the block, or 0 if no block is large enough
+ */
+static uint32_t heap_alloc(cache_shard *shard, uint32_t size) {
+    size = (size + SHMCACHE_ALIGN - 1) & ~(uint32_t)(SHMCACHE_ALIGN - 1);
+    if (size < sizeof(shm_free)) {
+        size = sizeof(shm_free);
+    }
+
+    uint32_t *linkp = &shard->hdr->free_list;
+    while (*linkp != 0) {
+        shm_free *block = off2ptr(shard, *linkp);
+        if (block->size >= size) {
+            if (block->size - size >= sizeof(shm_free) + SHMCACHE_ALIGN) {
+                /* Split, leaving the remainder on the free list */
+                shm_free *rest = (shm_free *)((char *)block + size);
+                rest->next = block->next;
+                rest->size = block->size - size;
+                *linkp = ptr2off(shard, rest);
+            } else {
+                size = block->size; /* Absorb the unsplittable tail */
+                *linkp = block->next;
+            }
+            ((shm_entry *)block)->block_size = size;
+            return ptr2off(shard, block);
+        }
+        linkp = &block->next;
+    }
+    return 0;
+}
+
+/*
+ * @brief Return a heap block to the free list, coalescing neighbors
+ *
+ * Requires the shard mutex to be held by the caller.
+ *
+ * param[in] shard: the shard whose heap the block came from
+ * param[in] off: the offset of the block
+ * param[in] size: the bytes the block spans, as heap_alloc sized it
+ */
+static void heap_free(cache_shard *shard, uint32_t off, uint32_t size) {
+    shm_free *block = off2ptr(shard, off);
+    block->size = size;
+
+    /* Keep the list in address order so adjacency is visible */
+    uint32_t *linkp = &shard->hdr->free_list;
+    while (*linkp != 0 && *linkp < off) {
+        linkp = &((shm_free *)off2ptr(shard, *linkp))->next;
+    }
+    block->next = *linkp;
+    *linkp = off;
+
+    /* Merge with the block after, then with the block before */
+    shm_free *after = off2ptr(shard, block->next);
+    if (after != NULL && off + block->size == ptr2off(shard, after)) {
+        block->size += after->size;
+        block->next = after->next;
+    }
+    if (linkp != &shard->hdr->free_list) {
+        shm_free *before =
+            (shm_free *)((char *)linkp - offsetof(shm_free, next));
+        if (ptr2off(shard, before) + before->size == off) {
+            before->size += block->size;
+            before->next = block->next;
+        }
+    }
+}
+
+void cache_init(void) {
+    /* Map the cache region, creating the file if this is the first boot */
+    const char *path = getenv("PROXY_CACHE_PATH");
+    char default_path[MAXLINE];
+    if (path == NULL) {
+        snprintf(default_path, MAXLINE, "%s/proxy-cache-%d", SHMCACHE_DIR,
+                 (int)getuid());
+        path = default_path;
+    }
+
+    char *region = NULL;
+    int fd = open(path, O_RDWR | O_CREAT, 0600);
+    if (fd >= 0 && ftruncate(fd, (off_t)SHMCACHE_REGION) == 0) {
+        region = mmap(NULL, SHMCACHE_REGION, PROT_READ | PROT_WRITE,
+                      MAP_SHARED, fd, 0);
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+    if (region == NULL || region == MAP_FAILED) {
+        /* No persistence available: fall back to a private region, which
+         * behaves exactly like a plain in-process cache */
+        fprintf(stderr, "cache: cannot map %s, running non-persistent\n",
+                path);
+        region = mmap(NULL, SHMCACHE_REGION, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    }
+
+    for (int i = 0; i < CACHE_SHARDS; i++) {
+        cache_shard *shard = &shards[i];
+        shard->base = region + (size_t)i * SEGMENT_SIZE;
+        shard->hdr = (shm_header *)shard->base;
+
+        if (shard->hdr->magic != SHMCACHE_MAGIC ||
+            shard->hdr->version != SHMCACHE_VERSION) {
+            /* A fresh or foreign segment: lay it out from scratch */
+            memset(shard->hdr, 0, sizeof(shm_header));
+
+            pthread_mutexattr_t attr;
+            pthread_mutexattr_init(&attr);
+            pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+            pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+            pthread_mutex_init(&shard->hdr->mutex, &attr);
+            pthread_mutexattr_destroy(&attr);
+
+            shard_reset_locked(shard);
+            shard->hdr->version = SHMCACHE_VERSION;
+            /* Written last: the segment is valid */
+            shard->hdr->magic = SHMCACHE_MAGIC;
+        }
+
+        pthread_cond_init(&shard->inflight_done, NULL);
+    }
+}
+
+/*
+ * @brief Find a shard's in-flight entry for a URI, or NULL if none
+ *
+ * Requires the shard mutex to be held by the caller.
+ *
+ * param[in] shard: the shard that owns the URI
+ * param[in] uri: the URI to search for
+ * return: the matching in-flight entry, or NULL
+ */
+static inflight_entry *inflight_find(cache_shard *shard, const char *uri) {
+    for (int i = 0; i < MAX_INFLIGHT; i++) {
+        if (shard->inflight[i].used &&
+            strcmp(shard->inflight[i].uri, uri) == 0) {
+            return &shard->inflight[i];
+        }
+    }
+    return NULL;
+}
+
+/*
+ * @brief Unlink an entry from its shard's LRU list
+ *
+ * Requires the shard mutex to be held by the caller.
+ *
+ * param[in] shard: the shard that owns the entry
+ * param[in] entry: the entry to unlink
+ */
+static void cache_unlink(cache_shard *shard, shm_entry *entry) {
+    shm_entry *prev = off2ptr(shard, entry->prev);
+    shm_entry *next = off2ptr(shard, entry->next);
+
+    if (prev != NULL) {
+        prev->next = entry->next;
+    } else {
+        shard->hdr->head = entry->next;
+    }
+    if (next != NULL) {
+        next->prev = entry->prev;
+    } else {
+        shard->hdr->tail = entry->prev;
+    }
+    entry->prev = 0;
+    entry->next = 0;
+}
+
+/*
+ * @brief Link an entry in at the front of its shard's LRU list
+ *
+ * Requires the shard mutex to be held by the caller.
+ *
+ * param[in] shard: the shard that owns the entry
+ * param[in] entry: the entry to link in as most recently used
+ */
+static void cache_push_front(cache_shard *shard, shm_entry *entry) {
+    entry->prev = 0;
+    entry->next = shard->hdr->head;
+
+    shm_entry *old_head = off2ptr(shard, shard->hdr->head);
+    if (old_head != NULL) {
+        old_head->prev = ptr2off(shard, entry);
+    } else {
+        shard->hdr->tail = ptr2off(shard, entry);
+    }
+    shard->hdr->head = ptr2off(shard, entry);
+}
+
+/*
+ * @brief Find the entry for a URI, or NULL if it is not cached
+ *
+ * Requires the shard mutex to be held by the caller.
+ *
+ * param[in] shard: the shard that owns the URI
+ * param[in] uri: the URI to search for
+ * return: the matching entry, or NULL
+ */
+static shm_entry *cache_find(cache_shard *shard, const char *uri) {
+    for (shm_entry *entry = off2ptr(shard, shard->hdr->head); entry != NULL;
+         entry = off2ptr(shard, entry->next)) {
+        if (strcmp(entry->bytes, uri) == 0) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * @brief Copy an object out of the cache if it is present
+ *
+ * Requires the shard mutex to be held by the caller. On a hit the object is
+ * copied out under the lock, so the caller cannot race with a later
+ * eviction, and marked most recently used.
+ *
+ * param[in] shard: the shard that owns the URI
+ * param[in] uri: the URI to look up
+ * param[in] arena: where to take the copy from, or NULL for Malloc
+ * param[out] data: receives a copy of the cached response on a hit
+ * param[out] size: receives the size of the cached response on a hit
+ * return: true on a hit
+ */
+static bool lookup_locked(cache_shard *shard, const char *uri, arena_t *arena,
+                          char **data, size_t *size) {
+    shm_entry *entry = cache_find(shard, uri);
+    if (entry == NULL || !entry_fresh(entry)) {
+        /* Absent, or present but stale: a stale entry is not served, only
+         * revalidated */
+        return false;
+    }
+
+    char *copy = arena != NULL ? arena_alloc(arena, entry->size)
+                               : Malloc(entry->size);
+    memcpy(copy, entry_data(entry), entry->size);
+    *data = copy;
+    *size = entry->size;
+
+    cache_unlink(shard, entry);
+    cache_push_front(shard, entry);
+    return true;
+}
+
+bool cache_lookup(const char *uri, arena_t *arena, char **data,
+                  size_t *size) {
+    cache_shard *shard = shard_for(uri);
+    shard_lock(shard);
+    bool hit = lookup_locked(shard, uri, arena, data, size);
+    pthread_mutex_unlock(&shard->hdr->mutex);
+    return hit;
+}
+
+cache_fetch_result cache_fetch_begin(const char *uri, arena_t *arena,
+                                     char **data, size_t *size, char *etag,
+                                     char *last_modified) {
+    cache_shard *shard = shard_for(uri);
+    bool waited = false;
+
+    etag[0] = '\0';
+    last_modified[0] = '\0';
+
+    shard_lock(shard);
+    while (true) {
+        if (lookup_locked(shard, uri, arena, data, size)) {
+            pthread_mutex_unlock(&shard->hdr->mutex);
+            return CACHE_FETCH_HIT;
+        }
+
+        if (inflight_find(shard, uri) == NULL) {
+            break;
+        }
+
+        /* Another thread is already fetching this URI: wait for it rather
+         * than dialing the origin too */
+        waited = true;
+        pthread_cond_wait(&shard->inflight_done, &shard->hdr->mutex);
+    }
+
+    if (waited) {
+        /* The fetch we waited on concluded without caching the object, so
+         * it cannot be served from memory; fetch independently instead of
+         * serializing every waiter behind a new leader */
+        pthread_mutex_unlock(&shard->hdr->mutex);
+        return CACHE_FETCH_MISS;
+    }
+
+    /* Become the leader for this URI, if a table slot is free. A stale
+     * entry with validators turns the leader's fetch into a conditional
+     * one: the origin can answer 304 instead of resending the object */
+    shm_entry *stale = cache_find(shard, uri);
+    bool revalidate = stale != NULL && (entry_etag(stale)[0] != '\0' ||
+                                        entry_lastmod(stale)[0] != '\0');
+    for (int i = 0; i < MAX_INFLIGHT; i++) {
+        if (!shard->inflight[i].used) {
+            shard->inflight[i].used = true;
+            snprintf(shard->inflight[i].uri, sizeof(shard->inflight[i].uri),
+                     "%s", uri);
+            if (revalidate) {
+                snprintf(etag, CACHE_VALIDATOR_MAX, "%s", entry_etag(stale));
+                snprintf(last_modified, CACHE_VALIDATOR_MAX, "%s",
+                         entry_lastmod(stale));
+            }
+            pthread_mutex_unlock(&shard->hdr->mutex);
+            return revalidate ? CACHE_FETCH_REVALIDATE : CACHE_FETCH_LEADER;
+        }
+    }
+
+    /* Table full: fetch independently, with no one waiting on us */
+    pthread_mutex_unlock(&shard->hdr->mutex);
+    return CACHE_FETCH_MISS;
+}
+
+void cache_refresh(const char *uri, long ttl_secs) {
+    if (ttl_secs <= 0) {
+        return;
+    }
+
+    cache_shard *shard = shard_for(uri);
+    shard_lock(shard);
+    shm_entry *entry = cache_find(shard, uri);
+    if (entry != NULL) {
+        entry->expires = (uint32_t)(time(NULL) + ttl_secs);
+        cache_unlink(shard, entry);
+        cache_push_front(shard, entry);
+    }
+    pthread_mutex_unlock(&shard->hdr->mutex);
+}
+
+void cache_fetch_end(const char *uri) {
+    cache_shard *shard = shard_for(uri);
+    shard_lock(shard);
+    inflight_entry *entry = inflight_find(shard, uri);
+    if (entry != NULL) {
+        entry->used = false;
+    }
+    pthread_cond_broadcast(&shard->inflight_done);
+    pthread_mutex_unlock(&shard->hdr->mutex);
+}
+
+/*
+ * @brief Evict a shard's least-recently-used entry
+ *
+ * Requires the shard mutex to be held by the caller and the list to be
+ * non-empty.
+ *
+ * param[in] shard: the shard to evict from
+ */
+static void evict_lru_locked(cache_shard *shard) {
+    shm_entry *victim = off2ptr(shard, shard->hdr->tail);
+    uint32_t off = ptr2off(shard, victim);
+    uint32_t block_size = victim->block_size;
+
+    cache_unlink(shard, victim);
+    shard->hdr->cache_size -= victim->size;
+    heap_free(shard, off, block_size);
+}
+
+void cache_insert(const char *uri, const char *data, size_t size,
+                  long ttl_secs, const char *etag,
+                  const char *last_modified) {
+    if (size > MAX_OBJECT_SIZE || ttl_secs <= 0) {
+        return;
+    }
+    if (etag == NULL) {
+        etag = "";
+    }
+    if (last_modified == NULL) {
+        last_modified = "";
+    }
+
+    cache_shard *shard = shard_for(uri);
+    shard_lock(shard);
+
+    /* An existing entry for this URI (another thread raced us, or a stale
+     * version just revalidated as changed) is replaced by the new bytes */
+    shm_entry *existing = cache_find(shard, uri);
+    if (existing != NULL) {
+        uint32_t off = ptr2off(shard, existing);
+        uint32_t block_size = existing->block_size;
+        cache_unlink(shard, existing);
+        shard->hdr->cache_size -= existing->size;
+        heap_free(shard, off, block_size);
+    }
+
+    /* Evict least-recently-used objects until the new one fits the shard's
+     * slice of the byte budget */
+    while (shard->hdr->cache_size + size > SHARD_BUDGET &&
+           shard->hdr->tail != 0) {
+        evict_lru_locked(shard);
+    }
+
+    /* The heap may still lack a large enough contiguous block when the
+     * budget is met but fragmented; evicting coalesces neighbors free */
+    size_t urilen = strlen(uri) + 1;
+    size_t etaglen = strlen(etag) + 1;
+    size_t lastmodlen = strlen(last_modified) + 1;
+    uint32_t need =
+        (uint32_t)(sizeof(shm_entry) + urilen + etaglen + lastmodlen + size);
+    uint32_t off;
+    while ((off = heap_alloc(shard, need)) == 0 && shard->hdr->tail != 0) {
+        evict_lru_locked(shard);
+    }
+    if (off == 0) {
+        pthread_mutex_unlock(&shard->hdr->mutex);
+        return;
+    }
+
+    shm_entry *entry = off2ptr(shard, off);
+    char *bytes = entry->bytes;
+    memcpy(bytes, uri, urilen);
+    memcpy(bytes + urilen, etag, etaglen);
+    memcpy(bytes + urilen + etaglen, last_modified, lastmodlen);
+    memcpy(bytes + urilen + etaglen + lastmodlen, data, size);
+    entry->size = (uint32_t)size;
+    entry->expires = (uint32_t)(time(NULL) + ttl_secs);
+    cache_push_front(shard, entry);
+    shard->hdr->cache_size += (uint32_t)size;
+
+    pthread_mutex_unlock(&shard->hdr->mutex);
+}
@@ -0,0 +1,165 @@
+/**
+ * @file cache.h
+ * @brief Interface for the proxy's in-memory web object cache
+ *
+ * The cache stores complete HTTP responses keyed on the request URI, so that
+ * repeated GET requests for the same object can be answered without contacting
+ * the origin server. The total size of all cached objects never exceeds
+ * MAX_CACHE_SIZE, and objects larger than MAX_OBJECT_SIZE are never stored.
+ * When an insertion would overflow the cache, the least-recently-used objects
+ * are evicted until the new object fits.
+ *
+ * Internally the cache is split into shards, each with its own lock and its
+ * own slice of the byte budget, so threads working on different objects do
+ * not serialize on one global mutex.
+ *
+ * The cache is backed by a memory-mapped file (PROXY_CACHE_PATH, defaulting
+ * to a per-user file on /dev/shm), holding the objects, the LRU metadata,
+ * and the byte budget alike, so a restarted proxy maps the previous cache
+ * back in and serves warm immediately instead of starting cold.
+ *
+ * All functions are safe to call concurrently from multiple threads.
+ */
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include "arena.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Max cache and object sizes */
+#define MAX_CACHE_SIZE (1024 * 1024)
+#define MAX_OBJECT_SIZE (100 * 1024)
+
+/* Size a buffer must have to receive an ETag or Last-Modified validator */
+#define CACHE_VALIDATOR_MAX 128
+
+/* Freshness lifetime, in seconds, given to a response that carries no
+ * explicit Cache-Control max-age or Expires */
+#define CACHE_DEFAULT_TTL_SECS 60
+
+/**
+ * @brief Initialize the cache
+ *
+ * Must be called once, before any other cache function, and before any
+ * threads that use the cache are created.
+ */
+void cache_init(void);
+
+/**
+ * @brief Look up a response by URI
+ *
+ * On a hit, a private copy of the cached object is returned through the
+ * output parameters and the object is marked as most recently used. The
+ * copy is carved from the caller's arena when one is given; with a NULL
+ * arena it comes from Malloc() and the caller must release it with Free().
+ *
+ * @param[in] uri The request URI used as the cache key
+ * @param[in] arena The arena to copy the object into, or NULL for Malloc
+ * @param[out] data Receives a pointer to a copy of the cached response
+ * @param[out] size Receives the size of the cached response in bytes
+ *
+ * @return true on a cache hit, false on a miss
+ */
+bool cache_lookup(const char *uri, arena_t *arena, char **data, size_t *size);
+
+/* What cache_fetch_begin told the caller to do */
+typedef enum {
+    CACHE_FETCH_HIT,        /* Served from the cache; data/size are filled
+                               in */
+    CACHE_FETCH_LEADER,     /* Miss; caller fetches and must call
+                               cache_fetch_end when its fetch concludes */
+    CACHE_FETCH_REVALIDATE, /* A stale copy with validators exists; caller
+                               fetches conditionally (If-None-Match /
+                               If-Modified-Since from the validator output
+                               parameters), calls cache_refresh() on a 304,
+                               and must call cache_fetch_end either way */
+    CACHE_FETCH_MISS        /* Miss after waiting on another fetch that did
+                               not produce a cacheable object; caller
+                               fetches independently and must not call
+                               cache_fetch_end */
+} cache_fetch_result;
+
+/**
+ * @brief Look up a response by URI, coalescing concurrent misses
+ *
+ * Like cache_lookup(), but when several threads miss on the same URI at
+ * once only the first becomes the leader and fetches from the origin; the
+ * others block until that fetch concludes and are then served from the
+ * cache, so a herd of N requests costs one origin round trip. If the
+ * leader's fetch does not produce a cacheable object, the waiters proceed
+ * to fetch independently rather than serializing behind one another.
+ *
+ * When the cache holds a stale copy of the URI that stored an ETag or
+ * Last-Modified value, the miss instead becomes CACHE_FETCH_REVALIDATE and
+ * the validators are returned, so the caller can ask the origin "has this
+ * changed?" rather than re-download an unchanged object.
+ *
+ * A caller told CACHE_FETCH_LEADER or CACHE_FETCH_REVALIDATE must call
+ * cache_fetch_end() once its fetch has concluded, whether or not it
+ * inserted anything, or the waiters will block forever.
+ *
+ * @param[in] uri The request URI used as the cache key
+ * @param[in] arena The arena to copy the object into, or NULL for Malloc
+ * @param[out] data On a hit, receives a copy of the cached response
+ * @param[out] size On a hit, receives the size of the cached response
+ * @param[out] etag The stale copy's ETag (CACHE_VALIDATOR_MAX bytes);
+ *                  empty unless revalidating
+ * @param[out] last_modified The stale copy's Last-Modified value
+ *                           (CACHE_VALIDATOR_MAX bytes); empty unless
+ *                           revalidating
+ *
+ * @return What the caller should do; see cache_fetch_result
+ */
+cache_fetch_result cache_fetch_begin(const char *uri, arena_t *arena,
+                                     char **data, size_t *size, char *etag,
+                                     char *last_modified);
+
+/**
+ * @brief Conclude a fetch started as CACHE_FETCH_LEADER
+ *
+ * Wakes every thread waiting on this URI. Call after cache_insert(), or
+ * after the fetch failed or produced an uncacheable object.
+ *
+ * @param[in] uri The request URI the caller was fetching
+ */
+void cache_fetch_end(const char *uri);
+
+/**
+ * @brief Extend the freshness lifetime of a cached entry
+ *
+ * Called after the origin answered a conditional request with 304 Not
+ * Modified: the stored bytes are still good, so only the expiry moves
+ * forward and the entry becomes most recently used. A URI that is no
+ * longer cached (evicted since the fetch began) is silently ignored, as
+ * is a non-positive lifetime.
+ *
+ * @param[in] uri The request URI used as the cache key
+ * @param[in] ttl_secs Seconds the entry stays fresh from now
+ */
+void cache_refresh(const char *uri, long ttl_secs);
+
+/**
+ * @brief Insert a response into the cache
+ *
+ * The cache makes its own copy of the URI, the validators, and the
+ * response bytes, so the caller's buffers need not outlive the call.
+ * Objects larger than MAX_OBJECT_SIZE and non-positive lifetimes are
+ * silently rejected; if the URI is already cached the old entry is
+ * replaced, since the caller's copy is the newer response.
+ *
+ * @param[in] uri The request URI used as the cache key
+ * @param[in] data The complete response (headers and body) to store
+ * @param[in] size The size of the response in bytes
+ * @param[in] ttl_secs Seconds the entry stays fresh; see also
+ *                     CACHE_DEFAULT_TTL_SECS
+ * @param[in] etag The response's ETag value, or "" / NULL for none
+ * @param[in] last_modified The response's Last-Modified value, or "" /
+ *                          NULL for none
+ */
+void cache_insert(const char *uri, const char *data, size_t size,
+                  long ttl_secs, const char *etag, const char *last_modified);
+
+#endif /* CACHE_H */
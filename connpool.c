@@ -0,0 +1,136 @@
+/*
+ * This file implements the idle origin connection pool declared in
+ * connpool.h as a fixed array of slots guarded by one mutex. Lookups and
+ * insertions scan linearly, discarding any entry that has sat idle past
+ * CONNPOOL_IDLE_SECS along the way, so stale sockets are reaped as a side
+ * effect of normal use and no background thread is needed.
+ */
+
+#include "connpool.h"
+#include "csapp.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sys/socket.h>
+
+/* One pooled idle connection */
+typedef struct {
+    bool used;          /* Slot holds a live connection */
+    char host[MAXLINE]; /* Origin host */
+    char port[32];      /* Origin port */
+    int fd;             /* The idle connected socket */
+    time_t idle_since;  /* When the socket was pooled */
+} pool_entry;
+
+static pool_entry pool[CONNPOOL_SLOTS];
+static pthread_mutex_t pool_mutex;
+
+void connpool_init(void) {
+    pthread_mutex_init(&pool_mutex, NULL);
+    for (int i = 0; i < CONNPOOL_SLOTS; i++) {
+        pool[i].used = false;
+    }
+}
+
+/*
+ * @brief Close and empty one pool slot
+ *
+ * Requires the pool mutex to be held by the caller.
+ *
+ * param[in] entry: the slot to drop
+ */
+static void pool_drop(pool_entry *entry) {
+    close(entry->fd);
+    entry->used = false;
+}
+
+/*
+ * @brief Check whether a pooled socket is still usable
+ *
+ * A socket is dead if the origin has closed its end (a non-blocking peek
+ * sees EOF) or if unexpected bytes have arrived on it, which would mean it
+ * is not at a response boundary after all.
+ *
+ * param[in] fd: the pooled socket
+ * return: true if the socket can be handed out
+ */
+static bool pool_fd_alive(int fd) {
+    char byte;
+    ssize_t n = recv(fd, &byte, 1, MSG_PEEK | MSG_DONTWAIT);
+    if (n == 0) {
+        return false; /* Origin closed the connection */
+    }
+    if (n > 0) {
+        return false; /* Stray bytes: connection is out of sync */
+    }
+    return errno == EAGAIN || errno == EWOULDBLOCK;
+}
+
+int connpool_get(const char *host, const char *port) {
+    time_t now = time(NULL);
+    int fd = -1;
+
+    pthread_mutex_lock(&pool_mutex);
+    for (int i = 0; i < CONNPOOL_SLOTS; i++) {
+        pool_entry *entry = &pool[i];
+        if (!entry->used) {
+            continue;
+        }
+        if (now - entry->idle_since > CONNPOOL_IDLE_SECS) {
+            pool_drop(entry);
+            continue;
+        }
+        if (fd < 0 && strcmp(entry->host, host) == 0 &&
+            strcmp(entry->port, port) == 0) {
+            if (!pool_fd_alive(entry->fd)) {
+                pool_drop(entry);
+                continue;
+            }
+            fd = entry->fd;
+            entry->used = false;
+            /* Keep scanning so the rest of the pool is still swept */
+        }
+    }
+    pthread_mutex_unlock(&pool_mutex);
+    return fd;
+}
+
+void connpool_put(const char *host, const char *port, int fd) {
+    time_t now = time(NULL);
+    pool_entry *slot = NULL;
+    pool_entry *oldest = NULL;
+
+    pthread_mutex_lock(&pool_mutex);
+    for (int i = 0; i < CONNPOOL_SLOTS; i++) {
+        pool_entry *entry = &pool[i];
+        if (entry->used && now - entry->idle_since > CONNPOOL_IDLE_SECS) {
+            pool_drop(entry);
+        }
+        if (!entry->used) {
+            if (slot == NULL) {
+                slot = entry;
+            }
+        } else if (oldest == NULL || entry->idle_since < oldest->idle_since) {
+            oldest = entry;
+        }
+    }
+
+    if (slot == NULL) {
+        /* Pool is full: the oldest idle connection makes room */
+        pool_drop(oldest);
+        slot = oldest;
+    }
+
+    slot->used = true;
+    snprintf(slot->host, sizeof(slot->host), "%s", host);
+    snprintf(slot->port, sizeof(slot->port), "%s", port);
+    slot->fd = fd;
+    slot->idle_since = now;
+    pthread_mutex_unlock(&pool_mutex);
+}
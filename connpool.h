@@ -0,0 +1,57 @@
+/**
+ * @file connpool.h
+ * @brief Interface for the pool of idle origin server connections
+ *
+ * Dialing the origin costs a full TCP handshake per request, which dominates
+ * latency for small objects. The pool keeps sockets whose responses have
+ * been fully consumed, keyed by (host, port), so the next request to the
+ * same origin can skip the handshake. Entries are dropped after an idle
+ * timeout, when the origin has closed its end, or when the pool is full and
+ * an older entry must make room.
+ *
+ * All functions except connpool_init() are safe to call concurrently from
+ * multiple threads.
+ */
+
+#ifndef CONNPOOL_H
+#define CONNPOOL_H
+
+/* Capacity of the pool and how long an idle socket is kept, in seconds */
+#define CONNPOOL_SLOTS 64
+#define CONNPOOL_IDLE_SECS 30
+
+/**
+ * @brief Initialize the connection pool
+ *
+ * Must be called once, before any threads that use the pool are created.
+ */
+void connpool_init(void);
+
+/**
+ * @brief Fetch an idle connection to the given origin, if one is pooled
+ *
+ * A returned socket has been checked to still be open on the origin's side.
+ * The caller owns it and must either close it or return it with
+ * connpool_put() once the next response has been fully consumed.
+ *
+ * @param[in] host The origin host
+ * @param[in] port The origin port
+ *
+ * @return A connected socket, or -1 if the pool has none for this origin
+ */
+int connpool_get(const char *host, const char *port);
+
+/**
+ * @brief Return an origin connection to the pool for reuse
+ *
+ * Only sockets positioned exactly at a response boundary may be pooled;
+ * anything else would corrupt the next request on the connection. If the
+ * pool is full the oldest idle entry is closed to make room.
+ *
+ * @param[in] host The origin host
+ * @param[in] port The origin port
+ * @param[in] fd The connected socket being given up by the caller
+ */
+void connpool_put(const char *host, const char *port, int fd);
+
+#endif /* CONNPOOL_H */
@@ -3,6 +3,10 @@
  * @brief Functions for the CS:APP3e book
  */
 
+/* SO_REUSEPORT is not part of POSIX, so _XOPEN_SOURCE alone hides it;
+ * _DEFAULT_SOURCE exposes it without pulling in all of _GNU_SOURCE */
+#define _DEFAULT_SOURCE
+
 #include "csapp.h"
 
 #include <errno.h>      /* errno */
@@ -484,7 +488,7 @@ static ssize_t rio_read(rio_t *rp, char *usrbuf, size_t n) {
     size_t cnt;
 
     while (rp->rio_cnt <= 0) { /* Refill if buf is empty */
-        rp->rio_cnt = read(rp->rio_fd, rp->rio_buf, sizeof(rp->rio_buf));
+        rp->rio_cnt = read(rp->rio_fd, rp->rio_bufbase, rp->rio_bufsize);
         if (rp->rio_cnt < 0) {
             if (errno != EINTR) {
                 return -1; /* errno set by read() */
@@ -494,7 +498,7 @@ static ssize_t rio_read(rio_t *rp, char *usrbuf, size_t n) {
         } else if (rp->rio_cnt == 0) {
             return 0; /* EOF */
         } else {
-            rp->rio_bufptr = rp->rio_buf; /* Reset buffer ptr */
+            rp->rio_bufptr = rp->rio_bufbase; /* Reset buffer ptr */
         }
     }
 
@@ -515,7 +519,24 @@ static ssize_t rio_read(rio_t *rp, char *usrbuf, size_t n) {
 void rio_readinitb(rio_t *rp, int fd) {
     rp->rio_fd = fd;
     rp->rio_cnt = 0;
-    rp->rio_bufptr = rp->rio_buf;
+    rp->rio_bufbase = rp->rio_buf;
+    rp->rio_bufsize = sizeof(rp->rio_buf);
+    rp->rio_bufptr = rp->rio_bufbase;
+}
+
+/*
+ * rio_readinitb_sz - Like rio_readinitb, but buffer through caller-provided
+ *     storage of the given size instead of the embedded RIO_BUFSIZE buffer.
+ *     The storage must outlive all reads through this rio_t. Lets callers
+ *     size the buffer to the traffic: large for bulk relays so each refill
+ *     syscall moves more bytes, small for header-only readers.
+ */
+void rio_readinitb_sz(rio_t *rp, int fd, void *buf, size_t size) {
+    rp->rio_fd = fd;
+    rp->rio_cnt = 0;
+    rp->rio_bufbase = buf;
+    rp->rio_bufsize = size;
+    rp->rio_bufptr = rp->rio_bufbase;
 }
 
 /*
@@ -538,6 +559,68 @@ ssize_t rio_readnb(rio_t *rp, void *usrbuf, size_t n) {
     return (ssize_t)(n - nleft); /* return >= 0 */
 }
 
+/*
+ * rio_readsomeb - Read up to n bytes, returning whatever is available: any
+ *     bytes already buffered are returned first; otherwise a single read()
+ *     is issued directly into the user buffer, bypassing the internal
+ *     buffer. Unlike rio_readnb this never blocks waiting to fill n bytes,
+ *     which is what a relay loop wants, and once the internal buffer is
+ *     drained it stays empty, so the caller can drop to raw descriptor
+ *     operations (e.g. splice) without losing buffered bytes.
+ */
+ssize_t rio_readsomeb(rio_t *rp, void *usrbuf, size_t n) {
+    if (rp->rio_cnt > 0) {
+        size_t cnt = n;
+        if ((size_t)rp->rio_cnt < n) {
+            cnt = (size_t)rp->rio_cnt;
+        }
+        memcpy(usrbuf, rp->rio_bufptr, cnt);
+        rp->rio_bufptr += cnt;
+        rp->rio_cnt -= cnt;
+        return (ssize_t)cnt;
+    }
+
+    ssize_t nread;
+    while ((nread = read(rp->rio_fd, usrbuf, n)) < 0) {
+        if (errno != EINTR) {
+            return -1; /* errno set by read() */
+        }
+    }
+    return nread;
+}
+
+/*
+ * rio_writevn - Robustly write a full iovec array to fd, continuing across
+ *     short writes and EINTR. The iovec array is adjusted in place as
+ *     writes complete. Returns the total bytes written, or -1 on error.
+ */
+ssize_t rio_writevn(int fd, struct iovec *iov, int iovcnt) {
+    ssize_t total = 0;
+    int cur = 0;
+
+    while (cur < iovcnt) {
+        ssize_t nwritten = writev(fd, iov + cur, iovcnt - cur);
+        if (nwritten < 0) {
+            if (errno == EINTR) {
+                continue; /* Interrupted by sig handler return, retry */
+            }
+            return -1; /* errno set by writev() */
+        }
+        total += nwritten;
+
+        /* Skip over iovecs that are now fully written */
+        while (cur < iovcnt && (size_t)nwritten >= iov[cur].iov_len) {
+            nwritten -= (ssize_t)iov[cur].iov_len;
+            cur++;
+        }
+        if (cur < iovcnt) {
+            iov[cur].iov_base = (char *)iov[cur].iov_base + nwritten;
+            iov[cur].iov_len -= (size_t)nwritten;
+        }
+    }
+    return total;
+}
+
 /*
  * rio_readlineb - Robustly read a text line (buffered)
  */
@@ -567,6 +650,68 @@ ssize_t rio_readlineb(rio_t *rp, void *usrbuf, size_t maxlen) {
     return (ssize_t)(n - 1);
 }
 
+/*
+ * rio_readhdrsb - Robustly read an HTTP header block (buffered). Reads up
+ *     to and including the blank line that terminates a request or response
+ *     head, scanning the internal buffer for newlines with memchr() instead
+ *     of issuing a read per byte. Bytes after the blank line stay buffered
+ *     for the next read, so a pipelined follow-up request is not lost. The
+ *     result is NUL-terminated. Returns the number of bytes placed in
+ *     usrbuf, 0 on EOF before any byte, or -1 on error; the caller should
+ *     verify the result ends with a blank line, since a head larger than
+ *     maxlen - 1 bytes is truncated.
+ */
+ssize_t rio_readhdrsb(rio_t *rp, void *usrbuf, size_t maxlen) {
+    char *bufp = usrbuf;
+    size_t total = 0;
+
+    while (total < maxlen - 1) {
+        while (rp->rio_cnt <= 0) { /* Refill if buf is empty */
+            rp->rio_cnt = read(rp->rio_fd, rp->rio_bufbase, rp->rio_bufsize);
+            if (rp->rio_cnt < 0) {
+                if (errno != EINTR) {
+                    return -1; /* errno set by read() */
+                }
+
+                /* Interrupted by sig handler return, nothing to do */
+            } else if (rp->rio_cnt == 0) {
+                goto done; /* EOF */
+            } else {
+                rp->rio_bufptr = rp->rio_bufbase; /* Reset buffer ptr */
+            }
+        }
+
+        size_t avail = (size_t)rp->rio_cnt;
+        if (avail > maxlen - 1 - total) {
+            avail = maxlen - 1 - total;
+        }
+
+        /* Consume up to and including the next newline, or everything
+         * available if no newline is buffered yet */
+        char *nl = memchr(rp->rio_bufptr, '\n', avail);
+        size_t take = nl != NULL ? (size_t)(nl - rp->rio_bufptr) + 1 : avail;
+        memcpy(bufp + total, rp->rio_bufptr, take);
+        rp->rio_bufptr += take;
+        rp->rio_cnt -= (ssize_t)take;
+        total += take;
+
+        if (nl != NULL) {
+            /* Was the line just finished blank? */
+            if (total >= 2 && bufp[total - 2] == '\n') {
+                break;
+            }
+            if (total >= 3 && bufp[total - 2] == '\r' &&
+                bufp[total - 3] == '\n') {
+                break;
+            }
+        }
+    }
+
+done:
+    bufp[total] = 0;
+    return (ssize_t)total;
+}
+
 /********************************
  * Client/server helper functions
  ********************************/
@@ -625,14 +770,11 @@ int open_clientfd(const char *hostname, const char *port) {
 }
 
 /*
- * open_listenfd - Open and return a listening socket on port. This
- *     function is reentrant and protocol-independent.
- *
- *     On error, returns:
- *       -2 for getaddrinfo error
- *       -1 with errno set for other errors.
+ * open_listenfd_internal - The shared body of open_listenfd and
+ *     open_listenfd_reuseport; reuseport selects whether SO_REUSEPORT is
+ *     set on the socket before binding.
  */
-int open_listenfd(const char *port) {
+static int open_listenfd_internal(const char *port, int reuseport) {
     struct addrinfo hints, *listp, *p;
     int listenfd = -1, rc, optval = 1;
 
@@ -659,6 +801,13 @@ int open_listenfd(const char *port) {
         setsockopt(listenfd, SOL_SOCKET, SO_REUSEADDR, (const void *)&optval,
                    sizeof(int));
 
+        /* Allow several sockets to bind this port, each with its own
+         * accept queue */
+        if (reuseport) {
+            setsockopt(listenfd, SOL_SOCKET, SO_REUSEPORT,
+                       (const void *)&optval, sizeof(int));
+        }
+
         /* Bind the descriptor to the address */
         if (bind(listenfd, p->ai_addr, p->ai_addrlen) == 0) {
             break; /* Success */
@@ -684,3 +833,26 @@ int open_listenfd(const char *port) {
     }
     return listenfd;
 }
+
+/*
+ * open_listenfd - Open and return a listening socket on port. This
+ *     function is reentrant and protocol-independent.
+ *
+ *     On error, returns:
+ *       -2 for getaddrinfo error
+ *       -1 with errno set for other errors.
+ */
+int open_listenfd(const char *port) {
+    return open_listenfd_internal(port, 0);
+}
+
+/*
+ * open_listenfd_reuseport - Like open_listenfd, but sets SO_REUSEPORT
+ *     before binding, so several listening sockets can share one port and
+ *     the kernel load-balances incoming connections across their accept
+ *     queues. Every socket bound to the port must set the option, so mixing
+ *     this with a plain open_listenfd on the same port will fail.
+ */
+int open_listenfd_reuseport(const char *port) {
+    return open_listenfd_internal(port, 1);
+}
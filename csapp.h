@@ -41,6 +41,7 @@
 #include <stdarg.h>    /* va_list */
 #include <stddef.h>    /* size_t */
 #include <sys/types.h> /* ssize_t */
+#include <sys/uio.h>   /* struct iovec */
 
 /* Default file permissions are DEF_MODE & ~DEF_UMASK */
 #define DEF_MODE S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH | S_IWOTH
@@ -52,7 +53,9 @@ typedef struct {
     int rio_fd;                /* Descriptor for this internal buf */
     ssize_t rio_cnt;           /* Unread bytes in internal buf */
     char *rio_bufptr;          /* Next unread byte in internal buf */
-    char rio_buf[RIO_BUFSIZE]; /* Internal buffer */
+    char *rio_bufbase;         /* Start of the internal buffer in use */
+    size_t rio_bufsize;        /* Size of the internal buffer in use */
+    char rio_buf[RIO_BUFSIZE]; /* Embedded default buffer */
 } rio_t;
 
 /* External variables */
@@ -94,11 +97,16 @@ void Free(void *ptr);
 ssize_t rio_readn(int fd, void *usrbuf, size_t n);
 ssize_t rio_writen(int fd, const void *usrbuf, size_t n);
 void rio_readinitb(rio_t *rp, int fd);
+void rio_readinitb_sz(rio_t *rp, int fd, void *buf, size_t size);
 ssize_t rio_readnb(rio_t *rp, void *usrbuf, size_t n);
+ssize_t rio_readsomeb(rio_t *rp, void *usrbuf, size_t n);
 ssize_t rio_readlineb(rio_t *rp, void *usrbuf, size_t maxlen);
+ssize_t rio_readhdrsb(rio_t *rp, void *usrbuf, size_t maxlen);
+ssize_t rio_writevn(int fd, struct iovec *iov, int iovcnt);
 
 /* Reentrant protocol-independent client/server helpers */
 int open_clientfd(const char *hostname, const char *port);
 int open_listenfd(const char *port);
+int open_listenfd_reuseport(const char *port);
 
 #endif /* CSAPP_H */
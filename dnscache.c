@@ -0,0 +1,190 @@
+/*
+ * This file implements the resolver cache declared in dnscache.h as a fixed
+ * array of entries guarded by one mutex, in the same shape as the origin
+ * connection pool. The mutex only covers the table itself: getaddrinfo()
+ * runs outside it, so a slow resolution never blocks other threads from
+ * reading the cache, at the cost of the occasional duplicate lookup when
+ * two threads miss on the same host at once.
+ */
+
+#include "dnscache.h"
+#include "csapp.h"
+
+#include <netdb.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Capacity of the cache */
+#define DNSCACHE_SLOTS 64
+
+/* One cached resolution, positive or negative */
+typedef struct {
+    bool used;
+    char host[MAXLINE];
+    char port[32];
+    bool negative; /* The lookup failed; addrs is empty */
+    time_t expires;
+    dns_addr addrs[DNSCACHE_MAX_ADDRS];
+    int naddrs;
+} dns_entry;
+
+static dns_entry table[DNSCACHE_SLOTS];
+static pthread_mutex_t table_mutex;
+
+void dnscache_init(void) {
+    pthread_mutex_init(&table_mutex, NULL);
+    for (int i = 0; i < DNSCACHE_SLOTS; i++) {
+        table[i].used = false;
+    }
+}
+
+/*
+ * @brief Look up a fresh cache entry for (host, port)
+ *
+ * Requires the table mutex to be held by the caller. Expired entries found
+ * along the way are dropped.
+ *
+ * param[in] host: the host being resolved
+ * param[in] port: the port being resolved
+ * param[in] now: the current time
+ * return: the matching fresh entry, or NULL
+ */
+static dns_entry *table_find(const char *host, const char *port, time_t now) {
+    for (int i = 0; i < DNSCACHE_SLOTS; i++) {
+        dns_entry *entry = &table[i];
+        if (!entry->used) {
+            continue;
+        }
+        if (now >= entry->expires) {
+            entry->used = false;
+            continue;
+        }
+        if (strcmp(entry->host, host) == 0 && strcmp(entry->port, port) == 0) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * @brief Store a resolution result, evicting the soonest-to-expire entry
+ *
+ * Requires the table mutex to be held by the caller.
+ *
+ * param[in] host: the host that was resolved
+ * param[in] port: the port that was resolved
+ * param[in] addrs: the resolved addresses, or NULL for a failed lookup
+ * param[in] naddrs: how many addresses were resolved
+ * param[in] now: the current time
+ */
+static void table_store(const char *host, const char *port,
+                        const dns_addr *addrs, int naddrs, time_t now) {
+    dns_entry *slot = NULL;
+    for (int i = 0; i < DNSCACHE_SLOTS; i++) {
+        dns_entry *entry = &table[i];
+        if (!entry->used) {
+            slot = entry;
+            break;
+        }
+        if (slot == NULL || entry->expires < slot->expires) {
+            slot = entry;
+        }
+    }
+
+    slot->used = true;
+    snprintf(slot->host, sizeof(slot->host), "%s", host);
+    snprintf(slot->port, sizeof(slot->port), "%s", port);
+    if (addrs == NULL) {
+        slot->negative = true;
+        slot->naddrs = 0;
+        slot->expires = now + DNSCACHE_NEGATIVE_TTL;
+    } else {
+        slot->negative = false;
+        slot->naddrs = naddrs;
+        memcpy(slot->addrs, addrs, sizeof(dns_addr) * (size_t)naddrs);
+        slot->expires = now + DNSCACHE_POSITIVE_TTL;
+    }
+}
+
+int dnscache_resolve(const char *host, const char *port, dns_addr *addrs,
+                     int max) {
+    time_t now = time(NULL);
+
+    pthread_mutex_lock(&table_mutex);
+    dns_entry *entry = table_find(host, port, now);
+    if (entry != NULL) {
+        if (entry->negative) {
+            pthread_mutex_unlock(&table_mutex);
+            return -1;
+        }
+        int n = entry->naddrs < max ? entry->naddrs : max;
+        memcpy(addrs, entry->addrs, sizeof(dns_addr) * (size_t)n);
+        pthread_mutex_unlock(&table_mutex);
+        return n;
+    }
+    pthread_mutex_unlock(&table_mutex);
+
+    /* Miss: resolve outside the lock */
+    struct addrinfo hints, *listp;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_NUMERICSERV | AI_ADDRCONFIG;
+
+    if (getaddrinfo(host, port, &hints, &listp) != 0) {
+        pthread_mutex_lock(&table_mutex);
+        table_store(host, port, NULL, 0, time(NULL));
+        pthread_mutex_unlock(&table_mutex);
+        return -1;
+    }
+
+    dns_addr resolved[DNSCACHE_MAX_ADDRS];
+    int naddrs = 0;
+    for (struct addrinfo *p = listp;
+         p != NULL && naddrs < DNSCACHE_MAX_ADDRS; p = p->ai_next) {
+        dns_addr *da = &resolved[naddrs];
+        memcpy(&da->addr, p->ai_addr, p->ai_addrlen);
+        da->addrlen = p->ai_addrlen;
+        da->family = p->ai_family;
+        da->socktype = p->ai_socktype;
+        da->protocol = p->ai_protocol;
+        naddrs++;
+    }
+    freeaddrinfo(listp);
+
+    if (naddrs == 0) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&table_mutex);
+    table_store(host, port, resolved, naddrs, time(NULL));
+    pthread_mutex_unlock(&table_mutex);
+
+    int n = naddrs < max ? naddrs : max;
+    memcpy(addrs, resolved, sizeof(dns_addr) * (size_t)n);
+    return n;
+}
+
+int dnscache_connect(const char *host, const char *port) {
+    dns_addr addrs[DNSCACHE_MAX_ADDRS];
+    int naddrs = dnscache_resolve(host, port, addrs, DNSCACHE_MAX_ADDRS);
+    if (naddrs < 0) {
+        return -1;
+    }
+
+    for (int i = 0; i < naddrs; i++) {
+        dns_addr *da = &addrs[i];
+        int fd = socket(da->family, da->socktype, da->protocol);
+        if (fd < 0) {
+            continue;
+        }
+        if (connect(fd, (struct sockaddr *)&da->addr, da->addrlen) == 0) {
+            return fd;
+        }
+        close(fd);
+    }
+    return -1;
+}
@@ -0,0 +1,74 @@
+/**
+ * @file dnscache.h
+ * @brief Interface for the proxy's resolver cache
+ *
+ * getaddrinfo() is a synchronous lookup that can sit on the critical path
+ * for tens of milliseconds, and a dead resolver stalls every worker that
+ * touches it. The cache memoizes resolved addresses per (host, port) with a
+ * TTL, and also remembers failed lookups for a short time (negative
+ * caching) so a host that does not resolve fails in microseconds instead of
+ * after a full resolution timeout.
+ *
+ * All functions except dnscache_init() are safe to call concurrently from
+ * multiple threads. A lookup that misses still resolves synchronously; the
+ * win is that every other request inside the TTL skips the resolver.
+ */
+
+#ifndef DNSCACHE_H
+#define DNSCACHE_H
+
+#include <sys/socket.h>
+
+/* How long resolved addresses and failures are remembered, in seconds */
+#define DNSCACHE_POSITIVE_TTL 60
+#define DNSCACHE_NEGATIVE_TTL 5
+
+/* The most addresses remembered per (host, port) */
+#define DNSCACHE_MAX_ADDRS 4
+
+/* One resolved address, everything needed to create and connect a socket */
+typedef struct {
+    struct sockaddr_storage addr;
+    socklen_t addrlen;
+    int family;
+    int socktype;
+    int protocol;
+} dns_addr;
+
+/**
+ * @brief Initialize the resolver cache
+ *
+ * Must be called once, before any threads that use the cache are created.
+ */
+void dnscache_init(void);
+
+/**
+ * @brief Resolve a (host, port) through the cache
+ *
+ * On a miss the lookup is performed with getaddrinfo() and the result (or
+ * the failure) is cached for later callers.
+ *
+ * @param[in] host The host to resolve
+ * @param[in] port The port, as a numeric string
+ * @param[out] addrs Receives up to max resolved addresses
+ * @param[in] max The capacity of addrs
+ *
+ * @return The number of addresses written, or -1 if resolution failed
+ */
+int dnscache_resolve(const char *host, const char *port, dns_addr *addrs,
+                     int max);
+
+/**
+ * @brief Connect to a host and port, resolving through the cache
+ *
+ * A drop-in replacement for open_clientfd() that skips getaddrinfo()
+ * whenever the address is already cached.
+ *
+ * @param[in] host The host to connect to
+ * @param[in] port The port to connect on, as a numeric string
+ *
+ * @return A connected socket, or -1 on error
+ */
+int dnscache_connect(const char *host, const char *port);
+
+#endif /* DNSCACHE_H */
@@ -0,0 +1,804 @@
+/*
+ * This file implements the proxy's event-driven serving mode. A single
+ * thread owns an epoll instance; the listening socket and both sockets of
+ * every in-flight connection are registered non-blocking, and each
+ * connection carries a small state machine that is advanced whenever one of
+ * its sockets becomes ready:
+ *
+ *   CONN_READ_REQUEST -> CONN_SEND_CACHED                    (cache hit)
+ *   CONN_READ_REQUEST -> CONN_CONNECT -> CONN_SEND_REQUEST
+ *                     -> CONN_RELAY                          (cache miss)
+ *
+ * Nothing in this mode blocks on a socket, so one slow client or origin
+ * only delays its own connection. Origin name resolution goes through the
+ * resolver cache; only an uncached lookup is still a synchronous step.
+ */
+
+#include "event.h"
+
+#include "cache.h"
+#include "csapp.h"
+#include "dnscache.h"
+#include "fastparse.h"
+#include "proxy.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+
+/* Max events returned by a single epoll_wait call */
+#define MAX_EVENTS 64
+
+/* The states a connection's state machine can be in */
+typedef enum {
+    CONN_READ_REQUEST, /* Reading request bytes from the client */
+    CONN_CONNECT,      /* Waiting for the origin connect() to finish */
+    CONN_SEND_REQUEST, /* Writing the rewritten request to the origin */
+    CONN_RELAY,        /* Relaying response bytes from origin to client */
+    CONN_SEND_CACHED   /* Writing a cached object to the client */
+} conn_state;
+
+struct conn;
+
+/* What an epoll event points at: one side of one connection. A NULL conn
+ * marks the listening socket itself */
+typedef struct {
+    struct conn *c;
+    bool is_origin;
+} fdref;
+
+/* All state for one client connection and its origin connection */
+typedef struct conn {
+    conn_state state;
+    int clientfd;
+    int originfd; /* -1 until the origin dial starts */
+
+    fdref clientref; /* epoll data for clientfd */
+    fdref originref; /* epoll data for originfd */
+
+    uint32_t client_events; /* Currently armed epoll events, clientfd */
+    uint32_t origin_events; /* Currently armed epoll events, originfd */
+    bool client_added;      /* clientfd registered with epoll */
+    bool origin_added;      /* originfd registered with epoll */
+
+    char reqbuf[MAXLINE]; /* Raw request bytes read from the client */
+    size_t reqlen;
+
+    char request[MAXLINE]; /* Rewritten request for the origin */
+    size_t request_len;
+    size_t request_sent;
+
+    char relay[MAXBUF]; /* In-flight response chunk */
+    size_t relay_len;
+    size_t relay_pos;
+    bool origin_eof;
+
+    char uri[MAXLINE];    /* Cache key */
+    char *object;         /* Response being accumulated for insertion, or
+                           * the cached object being sent on a hit */
+    size_t object_size;   /* Bytes accumulated / total cached size */
+    size_t object_sent;   /* Bytes of a cached object written so far */
+    bool object_too_big;  /* Response exceeded MAX_OBJECT_SIZE */
+
+    bool closing;           /* Torn down, awaiting deferred free */
+    struct conn *defer_next; /* Next connection on the deferred-free list */
+} conn;
+
+/* Connections torn down during the current event batch. Freeing is deferred
+ * until the batch ends, because a later event in the same batch may still
+ * point at the connection through its other socket */
+static conn *defer_list = NULL;
+
+/*
+ * @brief Set a file descriptor to non-blocking mode
+ *
+ * param[in] fd: the descriptor to modify
+ * return: 0 on success, -1 on error
+ */
+static int set_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags < 0) {
+        return -1;
+    }
+    return fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+/*
+ * @brief Register or update one socket's epoll interest set
+ *
+ * param[in] epfd: the epoll instance
+ * param[in] fd: the socket to arm
+ * param[in] ref: the fdref to deliver with events on this socket
+ * param[in] events: the desired event mask
+ * param[in,out] added: whether the socket is already registered
+ * param[in,out] current: the currently armed event mask
+ */
+static void arm_fd(int epfd, int fd, fdref *ref, uint32_t events, bool *added,
+                   uint32_t *current) {
+    if (*added && *current == events) {
+        return;
+    }
+
+    struct epoll_event ev;
+    ev.events = events;
+    ev.data.ptr = ref;
+    if (epoll_ctl(epfd, *added ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, fd, &ev) < 0) {
+        perror("epoll_ctl");
+        return;
+    }
+    *added = true;
+    *current = events;
+}
+
+/*
+ * @brief Arm both sockets of a connection for the events its state needs
+ *
+ * param[in] epfd: the epoll instance
+ * param[in] c: the connection
+ */
+static void conn_arm(int epfd, conn *c) {
+    uint32_t client_want = 0;
+    uint32_t origin_want = 0;
+
+    switch (c->state) {
+    case CONN_READ_REQUEST:
+        client_want = EPOLLIN;
+        break;
+    case CONN_CONNECT:
+    case CONN_SEND_REQUEST:
+        origin_want = EPOLLOUT;
+        break;
+    case CONN_RELAY:
+        /* Drain the relay buffer into the client before reading more from
+         * the origin, so a slow client cannot make us buffer the world */
+        if (c->relay_pos < c->relay_len) {
+            client_want = EPOLLOUT;
+        } else if (!c->origin_eof) {
+            origin_want = EPOLLIN;
+        }
+        break;
+    case CONN_SEND_CACHED:
+        client_want = EPOLLOUT;
+        break;
+    }
+
+    arm_fd(epfd, c->clientfd, &c->clientref, client_want, &c->client_added,
+           &c->client_events);
+    if (c->originfd >= 0) {
+        arm_fd(epfd, c->originfd, &c->originref, origin_want, &c->origin_added,
+               &c->origin_events);
+    }
+}
+
+/*
+ * @brief Tear down a connection's sockets and queue it for freeing
+ *
+ * The memory itself is released by defer_free_all() once the current event
+ * batch has been fully dispatched.
+ *
+ * param[in] epfd: the epoll instance
+ * param[in] c: the connection to destroy
+ */
+static void conn_close(int epfd, conn *c) {
+    if (c->closing) {
+        return;
+    }
+    if (c->client_added) {
+        epoll_ctl(epfd, EPOLL_CTL_DEL, c->clientfd, NULL);
+    }
+    if (c->origin_added) {
+        epoll_ctl(epfd, EPOLL_CTL_DEL, c->originfd, NULL);
+    }
+    close(c->clientfd);
+    if (c->originfd >= 0) {
+        close(c->originfd);
+    }
+    c->closing = true;
+    c->defer_next = defer_list;
+    defer_list = c;
+}
+
+/*
+ * @brief Free every connection closed during the event batch just dispatched
+ */
+static void defer_free_all(void) {
+    while (defer_list != NULL) {
+        conn *c = defer_list;
+        defer_list = c->defer_next;
+        if (c->object != NULL) {
+            Free(c->object);
+        }
+        Free(c);
+    }
+}
+
+/*
+ * @brief Parse the buffered request and build the rewritten origin request
+ *
+ * Runs once the full header block has arrived. Applies the same rules as
+ * the threaded path in proxy.c: the request line must parse, at least one
+ * header must be present, the client's User-Agent is replaced with the
+ * proxy's own, and the request is downgraded to HTTP/1.0. The client's
+ * Accept-Encoding is replaced with identity: the event loop caches under
+ * the plain URI, which the other modes treat as the identity variant, so
+ * an encoded body must never be fetched under that key. Parsing uses
+ * the same allocation-free single-pass parser as the threaded path,
+ * splitting reqbuf in place, so steady-state request handling does no
+ * parser-related heap traffic at all.
+ *
+ * param[in] c: the connection whose reqbuf holds a complete request
+ * param[out] host: receives the origin host, owned by fp
+ * param[out] port: receives the origin port, owned by fp
+ * param[in] fp: the caller's parser state; outlives the returned strings
+ * return: 0 on success, -1 on a malformed request, -2 on a non-GET method
+ */
+static int parse_buffered_request(conn *c, const char **host,
+                                  const char **port, fastparse_t *fp) {
+    if (c->reqlen >= sizeof(c->reqbuf)) {
+        return -1; /* No room left for the terminating NUL */
+    }
+    c->reqbuf[c->reqlen] = '\0';
+
+    if (!fastparse_parse(fp, c->reqbuf, c->reqlen)) {
+        return -1;
+    }
+
+    const char *method = NULL, *path = NULL, *uri = NULL;
+    fastparse_retrieve(fp, METHOD, &method);
+    fastparse_retrieve(fp, PATH, &path);
+    fastparse_retrieve(fp, URI, &uri);
+    *host = NULL;
+    *port = NULL;
+    fastparse_retrieve(fp, HOST, host);
+    fastparse_retrieve(fp, PORT, port);
+
+    if (strncmp(method, "GET", 3)) {
+        return -2;
+    }
+    if (*host == NULL) {
+        /* Neither the URI nor a Host header names the origin */
+        return -1;
+    }
+    if (*port == NULL) { // If no port is specified, use the default of 80
+        *port = "80";
+    }
+
+    snprintf(c->uri, MAXLINE, "%s", uri);
+
+    /* Rebuild the request, replacing the User-Agent and Accept-Encoding
+     * headers */
+    int len = snprintf(c->request, MAXLINE, "GET %s HTTP/1.0\r\n", path);
+    header_t *header;
+    size_t nheaders = 0;
+    while ((header = fastparse_next_header(fp)) != NULL) {
+        if (strncmp("User-agent", header->name, 10) &&
+            strncasecmp("Accept-Encoding", header->name, 15)) {
+            len += snprintf(c->request + len, MAXLINE - len, "%s: %s\r\n",
+                            header->name, header->value);
+            if (len >= MAXLINE) {
+                return -1;
+            }
+        }
+        nheaders++;
+    }
+    if (nheaders < 1) {
+        return -1;
+    }
+    len += snprintf(c->request + len, MAXLINE - len,
+                    "User-Agent: %s\r\nAccept-Encoding: identity\r\n\r\n",
+                    header_user_agent);
+    if (len >= MAXLINE) {
+        return -1;
+    }
+    c->request_len = (size_t)len;
+    c->request_sent = 0;
+    return 0;
+}
+
+/*
+ * @brief Begin a non-blocking connect to an origin server
+ *
+ * param[in] host: the origin host
+ * param[in] port: the origin port
+ * param[out] in_progress: set to true if the connect has not yet completed
+ * return: a connected or connecting socket, or -1 on error
+ */
+static int origin_connect(const char *host, const char *port,
+                          bool *in_progress) {
+    dns_addr addrs[DNSCACHE_MAX_ADDRS];
+    int naddrs = dnscache_resolve(host, port, addrs, DNSCACHE_MAX_ADDRS);
+    if (naddrs < 0) {
+        return -1;
+    }
+
+    int fd = -1;
+    *in_progress = false;
+    for (int i = 0; i < naddrs; i++) {
+        dns_addr *da = &addrs[i];
+        fd = socket(da->family, da->socktype, da->protocol);
+        if (fd < 0) {
+            continue;
+        }
+        if (set_nonblocking(fd) < 0) {
+            close(fd);
+            fd = -1;
+            continue;
+        }
+        if (connect(fd, (struct sockaddr *)&da->addr, da->addrlen) == 0) {
+            break;
+        }
+        if (errno == EINPROGRESS) {
+            *in_progress = true;
+            break;
+        }
+        close(fd);
+        fd = -1;
+    }
+    return fd;
+}
+
+/*
+ * @brief May this accumulated response be cached, and for how long?
+ *
+ * Mirrors the threaded path's cacheability gate: only Content-Length-framed
+ * 200 responses whose Cache-Control allows a shared cache to store them are
+ * inserted, with a lifetime from max-age or the default heuristic. Chunked
+ * and EOF-delimited bodies are excluded for the same reason as there -- a
+ * cached replay carries no framing to tell a kept-alive client where it
+ * ends. The cache region is shared with (and persists across) the other
+ * modes, so anything the event loop stores must meet the same bar they
+ * apply.
+ *
+ * param[in] object: the raw response, headers first (not NUL-terminated)
+ * param[in] size: the response size in bytes
+ * param[out] ttl: receives the freshness lifetime when cacheable
+ * return: true if the response may be inserted
+ */
+static bool response_cacheable(const char *object, size_t size, long *ttl) {
+    const char *end = object + size;
+    const char *line = object;
+    bool first = true;
+    bool no_store = false;
+    bool chunked = false;
+    long content_length = -1;
+    long max_age = -1;
+
+    while (line < end) {
+        const char *nl = memchr(line, '\n', (size_t)(end - line));
+        if (nl == NULL) {
+            return false;
+        }
+        if (line[0] == '\r' || line[0] == '\n') {
+            break; /* Blank line: end of the header block */
+        }
+
+        char linebuf[MAXLINE];
+        size_t linelen = (size_t)(nl - line) + 1;
+        if (linelen >= sizeof(linebuf)) {
+            linelen = sizeof(linebuf) - 1;
+        }
+        memcpy(linebuf, line, linelen);
+        linebuf[linelen] = '\0';
+
+        if (first) {
+            int status = -1;
+            sscanf(linebuf, "%*s %d", &status);
+            if (status != 200) {
+                return false;
+            }
+            first = false;
+        } else if (!strncasecmp(linebuf, "Content-Length:", 15)) {
+            content_length = atol(linebuf + 15);
+        } else if (!strncasecmp(linebuf, "Transfer-Encoding:", 18)) {
+            if (strstr(linebuf + 18, "chunked") != NULL) {
+                chunked = true;
+            }
+        } else if (!strncasecmp(linebuf, "Cache-Control:", 14)) {
+            /* Scan the directive list; a shared cache must not store
+             * private responses either */
+            for (const char *p = linebuf + 14; *p != '\0'; p++) {
+                if (!strncasecmp(p, "no-store", 8) ||
+                    !strncasecmp(p, "no-cache", 8) ||
+                    !strncasecmp(p, "private", 7)) {
+                    no_store = true;
+                } else if (!strncasecmp(p, "max-age=", 8)) {
+                    max_age = atol(p + 8);
+                }
+            }
+        }
+        line = nl + 1;
+    }
+
+    if (first || no_store || chunked || content_length < 0) {
+        return false;
+    }
+    *ttl = max_age >= 0 ? max_age : CACHE_DEFAULT_TTL_SECS;
+    return *ttl > 0;
+}
+
+/*
+ * @brief Finish a connection: cache the accumulated object and tear down
+ *
+ * param[in] epfd: the epoll instance
+ * param[in] c: the connection, whose relay buffer is drained and whose
+ * origin has reached EOF
+ */
+static void conn_finish_relay(int epfd, conn *c) {
+    long ttl;
+    if (!c->object_too_big && c->object != NULL &&
+        response_cacheable(c->object, c->object_size, &ttl)) {
+        /* The event loop keeps no validators; revalidation is the
+         * threaded path's concern */
+        cache_insert(c->uri, c->object, c->object_size, ttl, "", "");
+    }
+    conn_close(epfd, c);
+}
+
+/*
+ * @brief Advance a connection in the CONN_RELAY state
+ *
+ * Writes any buffered bytes to the client; when the buffer is drained,
+ * reads the next chunk from the origin. Stops at the first EAGAIN on
+ * either side and re-arms for the event it is now waiting on.
+ *
+ * param[in] epfd: the epoll instance
+ * param[in] c: the connection
+ */
+static void conn_do_relay(int epfd, conn *c) {
+    while (true) {
+        /* Flush the relay buffer to the client first */
+        while (c->relay_pos < c->relay_len) {
+            ssize_t n = write(c->clientfd, c->relay + c->relay_pos,
+                              c->relay_len - c->relay_pos);
+            if (n < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    conn_arm(epfd, c);
+                    return;
+                }
+                conn_close(epfd, c);
+                return;
+            }
+            c->relay_pos += (size_t)n;
+        }
+
+        if (c->origin_eof) {
+            conn_finish_relay(epfd, c);
+            return;
+        }
+
+        /* Buffer drained: pull the next chunk from the origin */
+        ssize_t n = read(c->originfd, c->relay, sizeof(c->relay));
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                conn_arm(epfd, c);
+                return;
+            }
+            conn_close(epfd, c);
+            return;
+        }
+        if (n == 0) {
+            c->origin_eof = true;
+            conn_finish_relay(epfd, c);
+            return;
+        }
+        c->relay_len = (size_t)n;
+        c->relay_pos = 0;
+
+        /* Accumulate for the cache while the object still fits */
+        if (!c->object_too_big) {
+            if (c->object_size + (size_t)n > MAX_OBJECT_SIZE) {
+                c->object_too_big = true;
+                if (c->object != NULL) {
+                    Free(c->object);
+                    c->object = NULL;
+                }
+            } else {
+                if (c->object == NULL) {
+                    c->object = Malloc(MAX_OBJECT_SIZE);
+                }
+                memcpy(c->object + c->object_size, c->relay, (size_t)n);
+                c->object_size += (size_t)n;
+            }
+        }
+    }
+}
+
+/*
+ * @brief Advance a connection in the CONN_SEND_REQUEST state
+ *
+ * param[in] epfd: the epoll instance
+ * param[in] c: the connection
+ */
+static void conn_do_send_request(int epfd, conn *c) {
+    while (c->request_sent < c->request_len) {
+        ssize_t n = write(c->originfd, c->request + c->request_sent,
+                          c->request_len - c->request_sent);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                conn_arm(epfd, c);
+                return;
+            }
+            clienterror(c->clientfd, "503", "Service Unavailable",
+                        "Failed to send request to server");
+            conn_close(epfd, c);
+            return;
+        }
+        c->request_sent += (size_t)n;
+    }
+    c->state = CONN_RELAY;
+    conn_do_relay(epfd, c);
+}
+
+/*
+ * @brief Advance a connection in the CONN_SEND_CACHED state
+ *
+ * param[in] epfd: the epoll instance
+ * param[in] c: the connection
+ */
+static void conn_do_send_cached(int epfd, conn *c) {
+    while (c->object_sent < c->object_size) {
+        ssize_t n = write(c->clientfd, c->object + c->object_sent,
+                          c->object_size - c->object_sent);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                conn_arm(epfd, c);
+                return;
+            }
+            break;
+        }
+        c->object_sent += (size_t)n;
+    }
+    conn_close(epfd, c);
+}
+
+/*
+ * @brief Check whether a buffer contains a full header block
+ *
+ * param[in] buf: the raw request bytes, not NUL-terminated
+ * param[in] len: the number of bytes in buf
+ * return: true if the blank line ending the headers has arrived
+ */
+static bool request_complete(const char *buf, size_t len) {
+    for (size_t i = 3; i < len; i++) {
+        if (buf[i - 3] == '\r' && buf[i - 2] == '\n' && buf[i - 1] == '\r' &&
+            buf[i] == '\n') {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * @brief Advance a connection in the CONN_READ_REQUEST state
+ *
+ * Reads whatever request bytes are available. Once the blank line ending
+ * the header block arrives, parses the request and either answers from the
+ * cache or starts the origin dial.
+ *
+ * param[in] epfd: the epoll instance
+ * param[in] c: the connection
+ */
+static void conn_do_read_request(int epfd, conn *c) {
+    while (true) {
+        if (c->reqlen >= sizeof(c->reqbuf)) {
+            /* Header block larger than we are willing to buffer */
+            clienterror(c->clientfd, "400", "Bad Request",
+                        "Proxy received a malformed request");
+            conn_close(epfd, c);
+            return;
+        }
+
+        ssize_t n = read(c->clientfd, c->reqbuf + c->reqlen,
+                         sizeof(c->reqbuf) - c->reqlen);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                conn_arm(epfd, c);
+                return;
+            }
+            conn_close(epfd, c);
+            return;
+        }
+        if (n == 0) {
+            /* Client went away without completing a request */
+            conn_close(epfd, c);
+            return;
+        }
+        c->reqlen += (size_t)n;
+
+        if (request_complete(c->reqbuf, c->reqlen)) {
+            break;
+        }
+    }
+
+    fastparse_t fp;
+    const char *host, *port;
+    int rc = parse_buffered_request(c, &host, &port, &fp);
+    if (rc == -2) {
+        clienterror(c->clientfd, "501", "Not Implemented",
+                    "Proxy does not implement this method");
+        conn_close(epfd, c);
+        return;
+    }
+    if (rc < 0) {
+        clienterror(c->clientfd, "400", "Bad Request",
+                    "Proxy received a malformed request");
+        conn_close(epfd, c);
+        return;
+    }
+
+    /* Cache hit: answer from memory without dialing the origin */
+    char *cached_data;
+    size_t cached_size;
+    if (cache_lookup(c->uri, NULL, &cached_data, &cached_size)) {
+        c->object = cached_data;
+        c->object_size = cached_size;
+        c->object_sent = 0;
+        c->state = CONN_SEND_CACHED;
+        conn_do_send_cached(epfd, c);
+        return;
+    }
+
+    bool in_progress;
+    c->originfd = origin_connect(host, port, &in_progress);
+    if (c->originfd < 0) {
+        clienterror(c->clientfd, "503", "Service Unavailable",
+                    "Failed to connect to server");
+        conn_close(epfd, c);
+        return;
+    }
+
+    if (in_progress) {
+        c->state = CONN_CONNECT;
+        conn_arm(epfd, c);
+    } else {
+        c->state = CONN_SEND_REQUEST;
+        conn_do_send_request(epfd, c);
+    }
+}
+
+/*
+ * @brief Advance a connection in the CONN_CONNECT state
+ *
+ * param[in] epfd: the epoll instance
+ * param[in] c: the connection whose origin socket became writable
+ */
+static void conn_do_connect(int epfd, conn *c) {
+    int err = 0;
+    socklen_t errlen = sizeof(err);
+    if (getsockopt(c->originfd, SOL_SOCKET, SO_ERROR, &err, &errlen) < 0 ||
+        err != 0) {
+        clienterror(c->clientfd, "503", "Service Unavailable",
+                    "Failed to connect to server");
+        conn_close(epfd, c);
+        return;
+    }
+    c->state = CONN_SEND_REQUEST;
+    conn_do_send_request(epfd, c);
+}
+
+/*
+ * @brief Dispatch one epoll event to the right state handler
+ *
+ * param[in] epfd: the epoll instance
+ * param[in] c: the connection the event is for
+ * param[in] events: the epoll event mask
+ */
+static void conn_dispatch(int epfd, conn *c, uint32_t events) {
+    if (c->closing) {
+        return;
+    }
+    if (events & (EPOLLERR | EPOLLHUP)) {
+        /* A hangup during relay may just be the origin closing after its
+         * response; let the state handler read the EOF. Everything else is
+         * fatal for the connection */
+        if (c->state != CONN_RELAY) {
+            conn_close(epfd, c);
+            return;
+        }
+    }
+
+    switch (c->state) {
+    case CONN_READ_REQUEST:
+        conn_do_read_request(epfd, c);
+        break;
+    case CONN_CONNECT:
+        conn_do_connect(epfd, c);
+        break;
+    case CONN_SEND_REQUEST:
+        conn_do_send_request(epfd, c);
+        break;
+    case CONN_RELAY:
+        conn_do_relay(epfd, c);
+        break;
+    case CONN_SEND_CACHED:
+        conn_do_send_cached(epfd, c);
+        break;
+    }
+}
+
+/*
+ * @brief Accept every pending connection on the listening socket
+ *
+ * param[in] epfd: the epoll instance
+ * param[in] listenfd: the listening socket
+ */
+static void accept_pending(int epfd, int listenfd) {
+    while (true) {
+        int connfd = accept(listenfd, NULL, NULL);
+        if (connfd < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                perror("accept");
+            }
+            return;
+        }
+        if (set_nonblocking(connfd) < 0) {
+            close(connfd);
+            continue;
+        }
+
+        conn *c = Calloc(1, sizeof(conn));
+        c->state = CONN_READ_REQUEST;
+        c->clientfd = connfd;
+        c->originfd = -1;
+        c->clientref.c = c;
+        c->clientref.is_origin = false;
+        c->originref.c = c;
+        c->originref.is_origin = true;
+        conn_arm(epfd, c);
+    }
+}
+
+void event_loop(int listenfd) {
+    int epfd = epoll_create1(0);
+    if (epfd < 0) {
+        perror("epoll_create1");
+        return;
+    }
+    if (set_nonblocking(listenfd) < 0) {
+        perror("fcntl");
+        return;
+    }
+
+    /* The listening socket is marked with a NULL conn */
+    static fdref listenref = {NULL, false};
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.ptr = &listenref;
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, listenfd, &ev) < 0) {
+        perror("epoll_ctl");
+        return;
+    }
+
+    struct epoll_event events[MAX_EVENTS];
+    while (true) {
+        int nready = epoll_wait(epfd, events, MAX_EVENTS, -1);
+        if (nready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("epoll_wait");
+            return;
+        }
+
+        for (int i = 0; i < nready; i++) {
+            fdref *ref = events[i].data.ptr;
+            if (ref->c == NULL) {
+                accept_pending(epfd, listenfd);
+            } else {
+                conn_dispatch(epfd, ref->c, events[i].events);
+            }
+        }
+        defer_free_all();
+    }
+}
@@ -0,0 +1,29 @@
+/**
+ * @file event.h
+ * @brief Interface for the proxy's event-driven serving mode
+ *
+ * In this mode one process multiplexes every connection over a single epoll
+ * instance instead of parking a kernel thread on each blocking read. Each
+ * connection is a small state machine that advances whenever its client or
+ * origin socket becomes ready, so thousands of slow clients cost only their
+ * buffer memory, not a thread apiece.
+ *
+ * The threaded worker pool in proxy.c remains the default mode; this one is
+ * selected with the -e command line flag.
+ */
+
+#ifndef EVENT_H
+#define EVENT_H
+
+/**
+ * @brief Run the event loop on an already-listening socket
+ *
+ * Accepts, parses, forwards and relays entirely from this thread using
+ * non-blocking sockets. Does not return except on an unrecoverable error
+ * with the epoll instance or the listening socket.
+ *
+ * @param[in] listenfd The listening socket, as returned by open_listenfd()
+ */
+void event_loop(int listenfd);
+
+#endif /* EVENT_H */
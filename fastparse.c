@@ -0,0 +1,237 @@
+/*
+ * This file implements the bulk request-head parser declared in fastparse.h.
+ * The head is carved into lines with memchr(), which the C library
+ * vectorizes, rather than a byte-at-a-time scan, and each line is split in
+ * place: delimiters are overwritten with NUL terminators so the parsed
+ * values are substrings of the caller's buffer and nothing is copied except
+ * the host and port, which need terminators the URI cannot spare.
+ */
+
+#include "fastparse.h"
+
+#include <string.h>
+#include <strings.h>
+
+/*
+ * @brief Split the URI into scheme, host, port, and path
+ *
+ * Handles both the absolute form a proxy receives ("http://host:port/path")
+ * and the origin form ("/path") a client uses when talking to the proxy
+ * directly, in which case the host stays empty here and is filled from the
+ * Host header once the headers are parsed. The URI itself is left intact
+ * so it can serve as the cache key.
+ *
+ * param[in,out] fp: the parse to fill in; fp->uri must already be set
+ * return: true if the URI was well formed
+ */
+static bool parse_uri(fastparse_t *fp) {
+    const char *rest = fp->uri;
+
+    if (rest[0] == '/') {
+        /* Origin form: no scheme or host, the whole URI is the path */
+        fp->path = rest;
+        return true;
+    }
+
+    if (strncasecmp(rest, "http://", 7) == 0) {
+        fp->scheme = "http";
+        rest += 7;
+    } else {
+        return false;
+    }
+
+    /* Host runs to the port, the path, or the end of the URI */
+    size_t hostlen = strcspn(rest, ":/");
+    if (hostlen == 0 || hostlen >= sizeof(fp->host)) {
+        return false;
+    }
+    memcpy(fp->host, rest, hostlen);
+    fp->host[hostlen] = '\0';
+    rest += hostlen;
+
+    if (*rest == ':') {
+        rest++;
+        size_t portlen = strcspn(rest, "/");
+        if (portlen == 0 || portlen >= sizeof(fp->port)) {
+            return false;
+        }
+        memcpy(fp->port, rest, portlen);
+        fp->port[portlen] = '\0';
+        rest += portlen;
+    }
+
+    /* A URI with no path component names the root */
+    fp->path = *rest == '/' ? rest : "/";
+    return true;
+}
+
+/*
+ * @brief Fill in the host and port from the Host header
+ *
+ * An origin-form request line carries no host of its own; per RFC 7230
+ * the Host header names the origin instead. A missing or oversized value
+ * leaves the host empty, and fastparse_retrieve(HOST) keeps reporting it
+ * as unavailable.
+ *
+ * param[in,out] fp: the parse whose host is still empty
+ */
+static void host_from_header(fastparse_t *fp) {
+    header_t *hdr = fastparse_lookup_header(fp, "Host");
+    if (hdr == NULL) {
+        return;
+    }
+
+    size_t hostlen = strcspn(hdr->value, ":");
+    if (hostlen == 0 || hostlen >= sizeof(fp->host)) {
+        return;
+    }
+    memcpy(fp->host, hdr->value, hostlen);
+    fp->host[hostlen] = '\0';
+
+    if (hdr->value[hostlen] == ':') {
+        const char *port = hdr->value + hostlen + 1;
+        size_t portlen = strlen(port);
+        if (portlen > 0 && portlen < sizeof(fp->port)) {
+            memcpy(fp->port, port, portlen + 1);
+        }
+    }
+}
+
+bool fastparse_parse(fastparse_t *fp, char *head, size_t len) {
+    fp->method = NULL;
+    fp->uri = NULL;
+    fp->scheme = NULL;
+    fp->path = NULL;
+    fp->version = NULL;
+    fp->host[0] = '\0';
+    strcpy(fp->port, "80");
+    fp->nheaders = 0;
+    fp->next_header = 0;
+
+    char *end = head + len;
+
+    /* --- The request line --- */
+    char *nl = memchr(head, '\n', len);
+    if (nl == NULL) {
+        return false;
+    }
+    char *eol = nl;
+    if (eol > head && eol[-1] == '\r') {
+        eol--;
+    }
+    *eol = '\0';
+
+    char *sp = strchr(head, ' ');
+    if (sp == NULL) {
+        return false;
+    }
+    *sp = '\0';
+    fp->method = head;
+
+    char *uri = sp + 1;
+    sp = strchr(uri, ' ');
+    if (sp == NULL) {
+        return false;
+    }
+    *sp = '\0';
+    fp->uri = uri;
+
+    if (strncmp(sp + 1, "HTTP/", 5) != 0) {
+        return false;
+    }
+    fp->version = sp + 6;
+
+    if (!parse_uri(fp)) {
+        return false;
+    }
+
+    /* --- The headers --- */
+    char *line = nl + 1;
+    while (line < end) {
+        nl = memchr(line, '\n', (size_t)(end - line));
+        if (nl == NULL) {
+            return false;
+        }
+        eol = nl;
+        if (eol > line && eol[-1] == '\r') {
+            eol--;
+        }
+        if (eol == line) {
+            /* Blank line: end of the head. An origin-form request names
+             * its origin in the Host header rather than the URI */
+            if (fp->host[0] == '\0') {
+                host_from_header(fp);
+            }
+            return true;
+        }
+        *eol = '\0';
+
+        char *colon = memchr(line, ':', (size_t)(eol - line));
+        if (colon == NULL || fp->nheaders >= FASTPARSE_MAX_HEADERS) {
+            return false;
+        }
+        *colon = '\0';
+        char *value = colon + 1;
+        while (*value == ' ' || *value == '\t') {
+            value++;
+        }
+
+        fp->headers[fp->nheaders].name = line;
+        fp->headers[fp->nheaders].value = value;
+        fp->nheaders++;
+        line = nl + 1;
+    }
+
+    /* The head never reached its terminating blank line */
+    return false;
+}
+
+int fastparse_retrieve(fastparse_t *fp, parser_value_type type,
+                       const char **val) {
+    switch (type) {
+    case METHOD:
+        *val = fp->method;
+        return 0;
+    case HOST:
+        if (fp->host[0] == '\0') {
+            return -2;
+        }
+        *val = fp->host;
+        return 0;
+    case SCHEME:
+        if (fp->scheme == NULL) {
+            return -2;
+        }
+        *val = fp->scheme;
+        return 0;
+    case URI:
+        *val = fp->uri;
+        return 0;
+    case PORT:
+        *val = fp->port;
+        return 0;
+    case PATH:
+        *val = fp->path;
+        return 0;
+    case HTTP_VERSION:
+        *val = fp->version;
+        return 0;
+    }
+    return -2;
+}
+
+header_t *fastparse_lookup_header(fastparse_t *fp, const char *name) {
+    for (size_t i = 0; i < fp->nheaders; i++) {
+        if (strcasecmp(fp->headers[i].name, name) == 0) {
+            return &fp->headers[i];
+        }
+    }
+    return NULL;
+}
+
+header_t *fastparse_next_header(fastparse_t *fp) {
+    if (fp->next_header >= fp->nheaders) {
+        return NULL;
+    }
+    return &fp->headers[fp->next_header++];
+}
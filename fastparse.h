@@ -0,0 +1,101 @@
+/**
+ * @file fastparse.h
+ * @brief Interface for the bulk HTTP request-head parser
+ *
+ * The parser library consumes a request one line at a time, which costs a
+ * byte-scan, a call, and a parser-state update per header. This module
+ * instead parses a complete request head (request line, headers, and the
+ * terminating blank line) in a single pass over one buffer, which pairs
+ * with rio_readhdrsb() reading the whole head in one gulp.
+ *
+ * The retrieval interface mirrors the parser library: the same
+ * parser_value_type names and header_t struct, so call sites translate
+ * one to one. Unlike the library nothing is heap allocated: returned
+ * strings point into the caller's head buffer (which is rewritten in
+ * place and must outlive every retrieval) or into the fastparse_t itself.
+ *
+ * A fastparse_t is owned by one thread and is not safe to share.
+ */
+
+#ifndef FASTPARSE_H
+#define FASTPARSE_H
+
+#include "http_parser.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* The most headers one request head may carry; parsing fails beyond this */
+#define FASTPARSE_MAX_HEADERS 64
+
+/* A parsed request head. Fill it in with fastparse_parse(); read it through
+ * the retrieval functions below */
+typedef struct {
+    const char *method;  /* e.g. GET */
+    const char *uri;     /* the URI exactly as the client sent it */
+    const char *scheme;  /* e.g. http, or NULL for an origin-form URI */
+    const char *path;    /* e.g. /index.html */
+    const char *version; /* without the HTTP/ prefix, e.g. 1.1 */
+    char host[MAXNAME];  /* empty for an origin-form URI */
+    char port[16];       /* defaults to 80 */
+
+    header_t headers[FASTPARSE_MAX_HEADERS];
+    size_t nheaders;
+    size_t next_header; /* iteration cursor for fastparse_next_header */
+} fastparse_t;
+
+/**
+ * @brief Parse a complete request head in one pass
+ *
+ * The head must contain the request line, the headers, and the blank line
+ * that terminates them, as read by rio_readhdrsb(). The buffer is rewritten
+ * in place (delimiters become NUL terminators), so it must stay alive and
+ * untouched for as long as the parsed values are used.
+ *
+ * @param[out] fp Receives the parsed request
+ * @param[in] head The complete request head
+ * @param[in] len The length of the head in bytes
+ *
+ * @return true if the head was well formed, false otherwise
+ */
+bool fastparse_parse(fastparse_t *fp, char *head, size_t len);
+
+/**
+ * @brief Retrieve a parsed field, as parser_retrieve() does
+ *
+ * @param[in] fp The parsed request
+ * @param[in] type The value to retrieve
+ * @param[out] val Receives a pointer to the value; untouched on failure
+ *
+ * @return 0 on success
+ * @return -2 if the request did not carry the requested value
+ */
+int fastparse_retrieve(fastparse_t *fp, parser_value_type type,
+                       const char **val);
+
+/**
+ * @brief Find a header by name, as parser_lookup_header() does
+ *
+ * The comparison ignores case, as header names are case-insensitive.
+ *
+ * @param[in] fp The parsed request
+ * @param[in] name The name of the header being looked up
+ *
+ * @return the matching header, or NULL if the request did not carry it
+ */
+header_t *fastparse_lookup_header(fastparse_t *fp, const char *name);
+
+/**
+ * @brief Iterate over the parsed headers, as parser_retrieve_next_header()
+ * does
+ *
+ * Headers are returned in the order the client sent them. The iterator
+ * does not restart after reaching the end.
+ *
+ * @param[in] fp The parsed request
+ *
+ * @return the next header, or NULL when none are left
+ */
+header_t *fastparse_next_header(fastparse_t *fp);
+
+#endif /* FASTPARSE_H */
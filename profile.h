@@ -0,0 +1,86 @@
+/**
+ * @file profile.h
+ * @brief Compile-time-optional cycle profiling of the request hot path
+ *
+ * Request-level latency stats say how long requests take; this module says
+ * where the cycles go inside one -- parsing, cache lookup, origin connect,
+ * response headers, relay. Each stage boundary in serve_request() carries a
+ * PROF_TICK / PROF_STAGE pair that reads the CPU cycle counter and folds
+ * the stage's cycles into a per-thread log2 histogram; sending the proxy
+ * SIGUSR1 dumps the aggregated histograms to stderr.
+ *
+ * Like the dbg_printf machinery, the hooks are compiled out entirely by
+ * default: build with -DPROFILE (see the Makefile) to enable them, so the
+ * shipping hot path pays nothing.
+ */
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+/* The instrumented stages of one request */
+typedef enum {
+    PROF_PARSE,    /* Reading and parsing the request head */
+    PROF_CACHE,    /* Cache lookup / miss coalescing */
+    PROF_CONNECT,  /* Dialing (or pooling) the origin */
+    PROF_HEADERS,  /* Waiting for and parsing the response head */
+    PROF_RELAY,    /* Relaying the response body */
+    PROF_NSTAGES
+} profile_stage;
+
+#ifdef PROFILE
+
+#include <stdint.h>
+#include <time.h>
+
+/**
+ * @brief Read the CPU cycle counter
+ *
+ * rdtsc on x86; elsewhere the monotonic clock in nanoseconds stands in,
+ * which keeps the histograms meaningful if not literally cycles.
+ *
+ * @return The current cycle count
+ */
+static inline uint64_t profile_cycles(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned lo, hi;
+    __asm__ __volatile__("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+/**
+ * @brief Initialize profiling and start the SIGUSR1 dump thread
+ *
+ * Must be called once from the main thread before any worker threads are
+ * created, so every thread inherits the blocked SIGUSR1 mask.
+ */
+void profile_init(void);
+
+/**
+ * @brief Fold one stage's elapsed cycles into the caller's histogram
+ *
+ * Lock-free: only touches the calling thread's own slot.
+ *
+ * @param[in] stage Which stage the cycles belong to
+ * @param[in] cycles How many cycles the stage took
+ */
+void profile_account(profile_stage stage, uint64_t cycles);
+
+/* Marks the start of a stage (declares the tick variable) and charges the
+ * cycles since a mark to a stage */
+#define PROF_TICK(var) uint64_t var = profile_cycles()
+#define PROF_STAGE(stage, since) profile_account(stage, profile_cycles() - (since))
+
+#else
+
+#define profile_init()
+#define PROF_TICK(var)
+#define PROF_STAGE(stage, since)
+
+#endif /* PROFILE */
+
+#endif /* PROFILE_H */
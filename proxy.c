@@ -10,10 +10,28 @@
  * unexpected crashes and maintain stability.
  */
 
+/* timegm, used when turning an Expires date into a lifetime, is not part
+ * of POSIX; _DEFAULT_SOURCE exposes it without all of _GNU_SOURCE */
+#define _DEFAULT_SOURCE
+
 /* Some useful includes to help you get started */
 
+#include "accesslog.h"
+#include "arena.h"
+#include "breaker.h"
+#include "bulk.h"
+#include "cache.h"
+#include "connpool.h"
 #include "csapp.h"
-#include "http_parser.h"
+#include "dnscache.h"
+#include "event.h"
+#include "fastparse.h"
+#include "profile.h"
+#include "proxy.h"
+#include "relay.h"
+#include "sbuf.h"
+#include "stats.h"
+#include "timeout.h"
 
 #include <assert.h>
 #include <ctype.h>
@@ -23,6 +41,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <strings.h>
+#include <time.h>
 #include <unistd.h>
 
 #include <errno.h>
@@ -32,6 +51,8 @@
 #include <signal.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
 
 /*
  * Debug macros, which can be enabled by adding -DDEBUG in the Makefile
@@ -46,20 +67,46 @@
 #endif
 
 /*
- * Max cache and object sizes
- * You might want to move these to the file containing your cache implementation
+ * String to use for the User-Agent header.
+ * Don't forget to terminate with \r\n
  */
-
-#define MAX_CACHE_SIZE (1024 * 1024)
-#define MAX_OBJECT_SIZE (100 * 1024)
+const char *header_user_agent = "Mozilla/5.0"
+                                " (X11; Linux x86_64; rv:3.10.0)"
+                                " Gecko/20230411 Firefox/63.0.1";
 
 /*
- * String to use for the User-Agent header.
- * Don't forget to terminate with \r\n
+ * Sizing of the worker pool. The pool is sized to the number of online cores
+ * (with a fallback if sysconf fails), and the connection queue holds enough
+ * accepted connections to absorb a burst without growing without bound.
  */
-static const char *header_user_agent = "Mozilla/5.0"
-                                       " (X11; Linux x86_64; rv:3.10.0)"
-                                       " Gecko/20230411 Firefox/63.0.1";
+#define FALLBACK_NWORKERS 8
+#define CONN_QUEUE_SLOTS 1024
+
+/* Capacity of each worker's request arena: enough for a full-size cached
+ * object, the relay buffers, and the request's other allocations without
+ * spilling */
+#define WORKER_ARENA_CAP (1024 * 1024)
+
+/* Buffer size used on the origin side of the relay. Much larger than
+ * RIO_BUFSIZE so each refill syscall moves up to a quarter megabyte of a
+ * bulk response instead of 8 KiB */
+#define RELAY_BUFSIZE (256 * 1024)
+
+/* The most listener shards the pool mode will run. Each shard is an
+ * acceptor thread with its own SO_REUSEPORT socket, so the kernel spreads
+ * incoming connections across that many independent accept queues */
+#define MAX_ACCEPT_SHARDS 8
+
+/* Queue depth past which new connections are shed with an immediate 503
+ * instead of being admitted; PROXY_MAX_QUEUED overrides it. Shedding at a
+ * watermark below the queue capacity keeps the acceptors from ever
+ * blocking in sbuf_insert, so the shed path itself stays fast */
+#define ADMISSION_WATERMARK (CONN_QUEUE_SLOTS * 3 / 4)
+
+static size_t admission_limit = ADMISSION_WATERMARK;
+
+/* The queue of accepted connections awaiting a worker */
+static sbuf_t conn_queue;
 
 /* The struct used to store information about the client */
 typedef struct {
@@ -70,6 +117,59 @@ typedef struct {
     char port[MAXLINE];           // Client port
 } client_info;
 
+/* Recycled client_info structs, so steady-state accepts stop paying for a
+ * Malloc/Free pair per connection */
+static client_info *client_info_freelist = NULL;
+static pthread_mutex_t client_info_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* The freelist chains spare structs through their connfd-adjacent storage;
+ * a small cap keeps a burst from pinning memory forever */
+#define CLIENT_INFO_SPARES 256
+static int client_info_spares = 0;
+
+/* Freelist linkage, overlaid on the struct while it is unused */
+typedef struct free_client {
+    struct free_client *next;
+} free_client;
+
+/*
+ * @brief Get a client_info, reusing a recycled one when available
+ *
+ * return: a client_info ready to be filled in
+ */
+static client_info *client_info_acquire(void) {
+    pthread_mutex_lock(&client_info_mutex);
+    free_client *spare = (free_client *)client_info_freelist;
+    if (spare != NULL) {
+        client_info_freelist = (client_info *)spare->next;
+        client_info_spares--;
+    }
+    pthread_mutex_unlock(&client_info_mutex);
+    if (spare != NULL) {
+        return (client_info *)spare;
+    }
+    return Malloc(sizeof(client_info));
+}
+
+/*
+ * @brief Return a client_info for reuse by a later accept
+ *
+ * param[in] client: the struct being given up; must not be used again
+ */
+static void client_info_release(client_info *client) {
+    pthread_mutex_lock(&client_info_mutex);
+    if (client_info_spares < CLIENT_INFO_SPARES) {
+        ((free_client *)client)->next = (free_client *)client_info_freelist;
+        client_info_freelist = client;
+        client_info_spares++;
+        client = NULL;
+    }
+    pthread_mutex_unlock(&client_info_mutex);
+    if (client != NULL) {
+        Free(client);
+    }
+}
+
 /*
  * @brief Used to send error messages back to the client, when any sort of error
  * during the process of serving the client has occured. Makes and sends simple
@@ -126,46 +226,534 @@ void clienterror(int fd, const char *errnum, const char *shortmsg,
     }
 }
 
+/* What the proxy learned from one response's header block */
+typedef struct {
+    int status;          /* The status code from the status line */
+    long content_length; /* The Content-Length value, or -1 if absent;
+                            forced to -1 when chunked (that framing wins) */
+    bool chunked;        /* The body uses chunked transfer coding */
+    bool keepalive;      /* The origin connection outlives the response */
+    bool no_store;       /* Cache-Control forbids storing the response */
+    long ttl;            /* Seconds the response may be served from cache */
+    char etag[CACHE_VALIDATOR_MAX];          /* ETag value, or "" */
+    char last_modified[CACHE_VALIDATOR_MAX]; /* Last-Modified value, or "" */
+} response_meta;
+
 /*
- * @brief The function ran by newly created threads that serves clients by
- * forwarding the request and returning the response
+ * @brief Copies a header value into a fixed validator buffer
  *
- * param[in] vargp: a pointer to a client_info struct, containing the details of
- * the client to be served return: NULL (required as the function that
- * intialised threads call)
+ * Skips leading spaces and stops at the line terminator, so the stored
+ * value can be pasted straight back into an If-None-Match or
+ * If-Modified-Since header later.
+ *
+ * param[in] value: the header value, starting after the colon
+ * param[out] out: receives the trimmed value, at most CACHE_VALIDATOR_MAX
  */
-void *serve(void *vargp) {
-    client_info *client = (client_info *)vargp;
-    pthread_detach(pthread_self()); // Detach the thread so it is reaped without
-                                    // the need to use pthread_join
+static void copy_validator(const char *value, char *out) {
+    while (*value == ' ') {
+        value++;
+    }
+    size_t i = 0;
+    while (i + 1 < CACHE_VALIDATOR_MAX && value[i] != '\0' &&
+           value[i] != '\r' && value[i] != '\n') {
+        out[i] = value[i];
+        i++;
+    }
+    out[i] = '\0';
+}
 
-    /* --- Reading the request --- */
-    parser_t *parser = parser_new();
+/*
+ * @brief Reads one response's header block from the origin
+ *
+ * Accumulates the raw header bytes (including the blank line) into buf so
+ * they can be forwarded verbatim, and extracts what the proxy needs to
+ * know about the response: the body framing, whether the origin keeps the
+ * connection open, and the caching policy -- how long the response stays
+ * fresh (Cache-Control max-age, or Expires, or the default heuristic) and
+ * the validators a later conditional request can present.
+ *
+ * param[in] server_rio: the buffered origin connection
+ * param[out] buf: receives the raw header bytes, at most MAXBUF
+ * param[out] meta: receives everything extracted; see response_meta
+ * return: the number of header bytes, or -1 on a read error or overflow
+ */
+static ssize_t read_response_headers(rio_t *server_rio, char *buf,
+                                     response_meta *meta) {
+    char line[MAXLINE];
+    size_t len = 0;
+    bool first = true;
+    long max_age = -1;
+    time_t expires_at = 0;
 
-    char buf_parser[MAXLINE];
+    memset(meta, 0, sizeof(*meta));
+    meta->status = -1;
+    meta->content_length = -1;
 
-    rio_t client_rio;
-    rio_readinitb(&client_rio, client->connfd);
-    if (rio_readlineb(&client_rio, buf_parser, MAXLINE) <= 0) {
-        /* No request was sent */
-        return NULL;
+    while (true) {
+        ssize_t n = rio_readlineb(server_rio, line, MAXLINE);
+        if (n <= 0) {
+            return -1;
+        }
+        if (len + (size_t)n > MAXBUF) {
+            return -1; // Header block larger than we are willing to buffer
+        }
+        memcpy(buf + len, line, (size_t)n);
+        len += (size_t)n;
+
+        if (line[0] == '\r' || line[0] == '\n') {
+            /* Blank line: end of the header block. 1xx, 204 and 304
+             * responses carry no body regardless of framing headers
+             * (RFC 7230 section 3.3.3), so force a zero length lest they
+             * be mistaken for EOF-delimited and block on the origin.
+             * Then settle the freshness lifetime: max-age wins over
+             * Expires, and a response saying neither gets the default
+             * heuristic lifetime */
+            if (meta->status / 100 == 1 || meta->status == 204 ||
+                meta->status == 304) {
+                meta->chunked = false;
+                meta->content_length = 0;
+            }
+            if (meta->chunked) {
+                meta->content_length = -1;
+            }
+            if (meta->no_store) {
+                meta->ttl = 0;
+            } else if (max_age >= 0) {
+                meta->ttl = max_age;
+            } else if (expires_at > 0) {
+                time_t now = time(NULL);
+                meta->ttl = expires_at > now ? (long)(expires_at - now) : 0;
+            } else {
+                meta->ttl = CACHE_DEFAULT_TTL_SECS;
+            }
+            return (ssize_t)len;
+        }
+
+        if (first) {
+            /* HTTP/1.1 origins default to persistent connections */
+            meta->keepalive = strncmp(line, "HTTP/1.1", 8) == 0;
+            sscanf(line, "%*s %d", &meta->status);
+            first = false;
+        } else if (!strncasecmp(line, "Content-Length:", 15)) {
+            meta->content_length = atol(line + 15);
+        } else if (!strncasecmp(line, "Transfer-Encoding:", 18)) {
+            /* Look for the chunked coding anywhere in the value */
+            for (const char *p = line + 18; *p != '\0'; p++) {
+                if (!strncasecmp(p, "chunked", 7)) {
+                    meta->chunked = true;
+                    break;
+                }
+            }
+        } else if (!strncasecmp(line, "Connection:", 11)) {
+            const char *value = line + 11;
+            while (*value == ' ') {
+                value++;
+            }
+            meta->keepalive = strncasecmp(value, "keep-alive", 10) == 0;
+        } else if (!strncasecmp(line, "Cache-Control:", 14)) {
+            /* Scan the directive list; a shared cache must not store
+             * private responses either */
+            for (const char *p = line + 14; *p != '\0'; p++) {
+                if (!strncasecmp(p, "no-store", 8) ||
+                    !strncasecmp(p, "no-cache", 8) ||
+                    !strncasecmp(p, "private", 7)) {
+                    meta->no_store = true;
+                } else if (!strncasecmp(p, "max-age=", 8)) {
+                    max_age = atol(p + 8);
+                }
+            }
+        } else if (!strncasecmp(line, "Expires:", 8)) {
+            const char *value = line + 8;
+            while (*value == ' ') {
+                value++;
+            }
+            struct tm tm;
+            memset(&tm, 0, sizeof(tm));
+            if (strptime(value, "%a, %d %b %Y %H:%M:%S", &tm) != NULL) {
+                expires_at = timegm(&tm);
+            }
+        } else if (!strncasecmp(line, "ETag:", 5)) {
+            copy_validator(line + 5, meta->etag);
+        } else if (!strncasecmp(line, "Last-Modified:", 14)) {
+            copy_validator(line + 14, meta->last_modified);
+        }
+    }
+}
+
+/*
+ * @brief Does this client accept a gzip response body?
+ *
+ * param[in] fp: the parsed request
+ * return: true if the Accept-Encoding header permits gzip
+ */
+static bool client_accepts_gzip(fastparse_t *fp) {
+    header_t *aehdr = fastparse_lookup_header(fp, "Accept-Encoding");
+    if (aehdr == NULL) {
+        return false;
+    }
+    for (const char *p = aehdr->value; *p != '\0'; p++) {
+        if (!strncasecmp(p, "gzip", 4)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* The most iovec entries one rewritten request can need: four per client
+ * header plus a fixed handful for the request line, the conditional
+ * headers, and the proxy's own tail */
+#define REQUEST_MAX_IOV (4 * FASTPARSE_MAX_HEADERS + 16)
+
+/*
+ * @brief Appends one piece to an iovec array being assembled
+ *
+ * param[in,out] iov: the array
+ * param[in,out] niov: the number of entries filled so far
+ * param[in] base: the piece's bytes, which must outlive the write
+ * param[in] len: the piece's length
+ */
+static void iov_add(struct iovec *iov, int *niov, const char *base,
+                    size_t len) {
+    iov[*niov].iov_base = (void *)base;
+    iov[*niov].iov_len = len;
+    (*niov)++;
+}
+
+/* Appends a string literal, letting the compiler measure it; hand-counted
+ * lengths are too easy to get off by one or two */
+#define iov_add_lit(iov, niov, lit) iov_add(iov, niov, lit, sizeof(lit) - 1)
+
+/*
+ * @brief Builds the request the proxy forwards to the origin
+ *
+ * Includes all the client's headers EXCEPT User-agent, which is specific
+ * to the proxy, the connection management headers, which the proxy sets
+ * for itself, and Accept-Encoding, which is replaced with the normalized
+ * form of the variant being fetched so every client on the same variant
+ * populates the same cache entry.
+ *
+ * Rather than copying every header into an assembly buffer and writing
+ * that, the request is built as an iovec array whose entries point
+ * straight at the parser-owned name and value strings plus constant
+ * separators, and goes out in one writev; no byte is copied between the
+ * parse buffer and the socket, and there is no assembly-buffer size to
+ * overflow. The caller's parse buffer (and validators, when given) must
+ * stay alive until the write completes.
+ *
+ * When revalidating a stale cache entry, its stored validators are turned
+ * into If-None-Match / If-Modified-Since headers here, so the origin can
+ * answer 304 Not Modified instead of resending the whole object.
+ *
+ * param[in] fp: the parsed client request
+ * param[in] client_gzip: whether the gzip variant is being fetched
+ * param[in] etag: If-None-Match value for a revalidation, or NULL / ""
+ * param[in] last_modified: If-Modified-Since value, or NULL / ""
+ * param[out] iov: receives the request pieces, REQUEST_MAX_IOV entries
+ * return: the number of iovec entries, or -1 if the client sent no headers
+ */
+static int build_origin_iov(fastparse_t *fp, bool client_gzip,
+                            const char *etag, const char *last_modified,
+                            struct iovec *iov) {
+    const char *path = NULL;
+    fastparse_retrieve(fp, PATH, &path);
+
+    int niov = 0;
+    iov_add_lit(iov, &niov, "GET ");
+    iov_add(iov, &niov, path, strlen(path));
+    iov_add_lit(iov, &niov, " HTTP/1.1\r\n");
+
+    header_t *curHeader = fastparse_next_header(fp);
+    size_t headers_parsed = 0;
+
+    while (curHeader != NULL) {
+        const char *header_name = curHeader->name;
+        if (strncmp("User-agent", header_name, 10) &&
+            strncasecmp("Connection", header_name, 10) &&
+            strncasecmp("Proxy-Connection", header_name, 16) &&
+            strncasecmp("Accept-Encoding", header_name, 15)) {
+            iov_add(iov, &niov, header_name, strlen(header_name));
+            iov_add_lit(iov, &niov, ": ");
+            iov_add(iov, &niov, curHeader->value, strlen(curHeader->value));
+            iov_add_lit(iov, &niov, "\r\n");
+        }
+        curHeader = fastparse_next_header(fp);
+        headers_parsed++;
+    }
+
+    if (headers_parsed < 1) {
+        return -1; /* Needs at least one header */
+    }
+
+    /* The conditional headers, when a stale copy is being revalidated */
+    if (etag != NULL && etag[0] != '\0') {
+        iov_add_lit(iov, &niov, "If-None-Match: ");
+        iov_add(iov, &niov, etag, strlen(etag));
+        iov_add_lit(iov, &niov, "\r\n");
+    }
+    if (last_modified != NULL && last_modified[0] != '\0') {
+        iov_add_lit(iov, &niov, "If-Modified-Since: ");
+        iov_add(iov, &niov, last_modified, strlen(last_modified));
+        iov_add_lit(iov, &niov, "\r\n");
+    }
+
+    /* The proxy's own User-Agent, plus a keep-alive ask so the origin
+     * connection can be pooled */
+    iov_add_lit(iov, &niov, "User-Agent: ");
+    iov_add(iov, &niov, header_user_agent, strlen(header_user_agent));
+    iov_add_lit(iov, &niov, "\r\nAccept-Encoding: ");
+    if (client_gzip) {
+        iov_add_lit(iov, &niov, "gzip");
+    } else {
+        iov_add_lit(iov, &niov, "identity");
+    }
+    iov_add_lit(iov, &niov, "\r\nConnection: keep-alive\r\n\r\n");
+
+    return niov;
+}
+
+/* One connection's pipeline state: the next request's head when it has
+ * already been pulled off the client buffer, and the origin fetch that was
+ * dispatched for it while the previous response was still being relayed */
+typedef struct {
+    bool have_head;  /* head[] holds the next request */
+    bool dispatched; /* originfd carries an in-flight fetch for it */
+    int originfd;
+    ssize_t head_len;
+    char head[MAXBUF];
+} pipeline_t;
+
+/*
+ * @brief Is a complete request head already sitting in the client buffer?
+ *
+ * Looks for the head-terminating blank line in the bytes rio has buffered
+ * but not yet consumed, without consuming them.
+ *
+ * param[in] rp: the buffered client connection
+ * return: true if a whole head can be read without blocking
+ */
+static bool head_buffered(rio_t *rp) {
+    const char *buf = rp->rio_bufptr;
+    for (ssize_t i = 0; i + 1 < rp->rio_cnt; i++) {
+        if (buf[i] == '\n' &&
+            (buf[i + 1] == '\n' ||
+             (buf[i + 1] == '\r' && i + 2 < rp->rio_cnt &&
+              buf[i + 2] == '\n'))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * @brief Starts the next pipelined request's origin fetch, if one is ready
+ *
+ * Called after request N has been forwarded, before its response is
+ * relayed: if the client pipelined request N+1 behind it, its head is
+ * already buffered, so it is pulled off and its origin fetch dispatched
+ * now. The fetch then travels to the origin and back while response N is
+ * still streaming, hiding the origin round trip entirely. Requests the
+ * proxy cannot pre-dispatch (non-GET, the stats endpoint, connect
+ * failures) still have their head saved, and the next serve_request pass
+ * handles them exactly as if it had read them itself.
+ *
+ * param[in] client_rio: the buffered client connection
+ * param[in,out] pl: the connection's pipeline state
+ */
+static void pipeline_predispatch(rio_t *client_rio, pipeline_t *pl) {
+    if (pl->have_head || !head_buffered(client_rio)) {
+        return;
+    }
+
+    pl->head_len = rio_readhdrsb(client_rio, pl->head, MAXBUF);
+    if (pl->head_len <= 0) {
+        pl->head_len = 0;
+        return;
+    }
+    pl->have_head = true;
+    pl->dispatched = false;
+
+    /* Parse a copy: fastparse splits its buffer in place, and the saved
+     * head must reach the next serve_request pass intact */
+    char scratch[MAXBUF];
+    memcpy(scratch, pl->head, (size_t)pl->head_len + 1);
+    fastparse_t fp;
+    if (!fastparse_parse(&fp, scratch, (size_t)pl->head_len)) {
+        return;
+    }
+
+    const char *method = NULL, *path = NULL, *port = "80", *host = NULL;
+    fastparse_retrieve(&fp, METHOD, &method);
+    fastparse_retrieve(&fp, PATH, &path);
+    fastparse_retrieve(&fp, PORT, &port);
+    fastparse_retrieve(&fp, HOST, &host);
+    if (strncmp(method, "GET", 3) != 0 || host == NULL ||
+        (path != NULL && strcmp(path, STATS_ENDPOINT) == 0)) {
+        return;
+    }
+
+    struct iovec req_iov[REQUEST_MAX_IOV];
+    int req_niov = build_origin_iov(&fp, client_accepts_gzip(&fp), NULL,
+                                    NULL, req_iov);
+    if (req_niov < 0) {
+        return;
+    }
+
+    int originfd = connpool_get(host, port);
+    if (originfd < 0) {
+        if (!breaker_allow(host, port)) {
+            return; /* Circuit open: the serve_request pass fails it fast */
+        }
+        originfd = dnscache_connect(host, port);
+        if (originfd < 0) {
+            breaker_failure(host, port);
+            return;
+        }
+        breaker_success(host, port);
+    }
+    timeout_set(originfd, TIMEOUT_ORIGIN_SECS, TIMEOUT_ORIGIN_SECS);
+    rio_writevn(originfd, req_iov, req_niov);
+
+    pl->originfd = originfd;
+    pl->dispatched = true;
+}
+
+/*
+ * @brief Relays a chunked response body, following its framing
+ *
+ * Forwards the chunked bytes verbatim (size lines, chunk data, and the
+ * trailer) while decoding the sizes, so the relay knows exactly where the
+ * body ends and can stop without waiting for the origin to close.
+ *
+ * param[in] server_rio: the buffered origin connection
+ * param[in] connfd: the client connection
+ * param[in,out] rs: this request's statistics, relay bytes are added
+ * param[in] deadline: the whole-request deadline, in stats_now_ns() terms
+ * return: true if the full body arrived intact, false if the framing broke
+ * or the deadline passed
+ */
+static bool relay_chunked(rio_t *server_rio, int connfd, req_stats *rs,
+                          uint64_t deadline) {
+    char line[MAXLINE];
+
+    while (true) {
+        if (stats_now_ns() > deadline) {
+            return false; /* Evicted: the request deadline passed */
+        }
+        /* The chunk-size line, a hex count optionally followed by
+         * extensions */
+        ssize_t n = rio_readlineb(server_rio, line, MAXLINE);
+        if (n <= 0) {
+            return false;
+        }
+        char *end;
+        long chunk_size = strtol(line, &end, 16);
+        if (end == line || chunk_size < 0) {
+            return false;
+        }
+        rio_writen(connfd, line, (size_t)n);
+        rs->relay_bytes += (size_t)n;
+
+        if (chunk_size == 0) {
+            break;
+        }
+
+        /* The chunk data plus its trailing CRLF */
+        long remaining = chunk_size + 2;
+        char data[MAXBUF];
+        while (remaining > 0) {
+            size_t want =
+                remaining < MAXBUF ? (size_t)remaining : (size_t)MAXBUF;
+            ssize_t nread = rio_readnb(server_rio, data, want);
+            if (nread <= 0) {
+                return false;
+            }
+            rio_writen(connfd, data, (size_t)nread);
+            rs->relay_bytes += (size_t)nread;
+            remaining -= nread;
+        }
+    }
+
+    /* The trailer: zero or more header lines, then a blank line */
+    while (true) {
+        ssize_t n = rio_readlineb(server_rio, line, MAXLINE);
+        if (n <= 0) {
+            return false;
+        }
+        rio_writen(connfd, line, (size_t)n);
+        rs->relay_bytes += (size_t)n;
+        if (line[0] == '\r' || line[0] == '\n') {
+            return true;
+        }
+    }
+}
+
+/*
+ * @brief Serves a single request on a client connection
+ *
+ * Forwards the request to the origin (reusing a pooled connection when one
+ * is available) and relays the response back. If the response carries a
+ * Content-Length and the origin keeps the connection open, the origin
+ * socket is returned to the pool for the next request to that (host, port).
+ *
+ * param[in] client: the details of the client to be served
+ * param[in] client_rio: the buffered client connection
+ * param[in] arena: the worker's request arena, reset between requests
+ * return: true if the client connection should be kept open for another
+ * request
+ */
+static bool serve_request(client_info *client, rio_t *client_rio,
+                          arena_t *arena, pipeline_t *pl) {
+    /* --- Reading the request --- */
+
+    /* Read the whole request head in one gulp and parse it in a single
+     * pass, instead of paying a readline plus a parser call per header.
+    * A head that pipeline_predispatch already pulled off the buffer is
+     * taken from the pipeline instead, along with any origin fetch it
+     * managed to start while the previous response was being relayed */
+    char head[MAXBUF];
+    ssize_t head_len;
+    int predispatched_fd = -1;
+    if (pl->have_head) {
+        memcpy(head, pl->head, (size_t)pl->head_len + 1);
+        head_len = pl->head_len;
+        pl->have_head = false;
+        if (pl->dispatched) {
+            predispatched_fd = pl->originfd;
+            pl->dispatched = false;
+        }
+    } else {
+        head_len = rio_readhdrsb(client_rio, head, MAXBUF);
+        if (head_len <= 0) {
+            /* No request was sent */
+            return false;
+        }
     }
 
-    parser_state parse_state = parser_parse_line(parser, buf_parser);
+    /* Stage timings for this request; recorded once it completes */
+    req_stats rs;
+    memset(&rs, 0, sizeof(rs));
+    uint64_t t_stage = stats_now_ns();
+    uint64_t t_start = t_stage;
+    PROF_TICK(prof_parse);
 
-    if (parse_state != REQUEST) {
+    fastparse_t fp;
+    if (!fastparse_parse(&fp, head, (size_t)head_len)) {
         /* Malformed request */
-        parser_free(parser);
+        if (predispatched_fd >= 0) {
+            close(predispatched_fd);
+        }
         clienterror(client->connfd, "400", "Bad Request",
                     "Proxy received a malformed request");
-        return NULL;
+        return false;
     }
 
-    const char *method, *path, *port, *host;
-    parser_retrieve(parser, METHOD, &method);
-    parser_retrieve(parser, PATH, &path);
-    parser_retrieve(parser, PORT, &port);
-    parser_retrieve(parser, HOST, &host);
+    const char *method = NULL, *path = NULL, *port = NULL, *host = NULL,
+               *uri = NULL;
+    fastparse_retrieve(&fp, METHOD, &method);
+    fastparse_retrieve(&fp, PATH, &path);
+    fastparse_retrieve(&fp, PORT, &port);
+    fastparse_retrieve(&fp, HOST, &host);
+    fastparse_retrieve(&fp, URI, &uri);
 
     if (strncmp(method, "GET", 3)) {
         /* All requests that aren't of type GET to the server aren't implemented
@@ -178,70 +766,180 @@ void *serve(void *vargp) {
         port = "80";
     }
 
-    char request[MAXLINE];
-    while (rio_readlineb(&client_rio, buf_parser, MAXLINE) > 2) {
-        parse_state = parser_parse_line(parser, buf_parser);
+    /* Does the client want the connection kept open afterwards? HTTP/1.1
+     * defaults to yes; a Connection header on the request overrides */
+    const char *version;
+    bool client_keepalive = fastparse_retrieve(&fp, HTTP_VERSION, &version) ==
+                                0 &&
+                            strcmp(version, "1.1") == 0;
+    header_t *connhdr = fastparse_lookup_header(&fp, "Connection");
+    if (connhdr != NULL) {
+        client_keepalive = strncasecmp(connhdr->value, "keep-alive", 10) == 0;
+    }
 
-        if (parse_state != HEADER) {
-            /* Malformed request */
-            parser_free(parser);
-            clienterror(client->connfd, "400", "Bad Request",
-                        "Proxy received a malformed request");
-            return NULL;
+    /* Can this client consume a gzip response body? Most can, and letting
+     * the origin compress for them multiplies what fits in the cache and
+     * cuts egress; the rest get the identity variant */
+    bool client_gzip = client_accepts_gzip(&fp);
+
+    rs.parse_ns = stats_now_ns() - t_stage;
+    PROF_STAGE(PROF_PARSE, prof_parse);
+
+    /* The statistics endpoint is answered by the proxy itself */
+    if (path != NULL && strcmp(path, STATS_ENDPOINT) == 0) {
+        if (predispatched_fd >= 0) {
+            close(predispatched_fd);
         }
+        char report[MAXBUF];
+        size_t report_len = stats_format(report, MAXBUF);
+        char stats_hdr[MAXLINE];
+        int stats_hdr_len = snprintf(stats_hdr, MAXLINE,
+                                     "HTTP/1.0 200 OK\r\n"
+                                     "Content-Type: text/plain\r\n"
+                                     "Content-Length: %zu\r\n\r\n",
+                                     report_len);
+        rio_writen(client->connfd, stats_hdr, (size_t)stats_hdr_len);
+        rio_writen(client->connfd, report, report_len);
+        return client_keepalive;
     }
 
-    /* --- Forming the request for the server --- */
-    snprintf(request, MAXLINE, "GET %s HTTP/1.0\r\n", path);
+    /* A request that names its origin in neither the URI nor a Host
+     * header cannot be forwarded anywhere; host must never reach the
+     * connect path as NULL */
+    if (host == NULL) {
+        if (predispatched_fd >= 0) {
+            close(predispatched_fd);
+        }
+        clienterror(client->connfd, "400", "Bad Request",
+                    "Proxy received a request without a host");
+        return false;
+    }
 
-    header_t *curHeader = parser_retrieve_next_header(parser);
-    size_t headers_parsed;
+    /* --- Checking the cache --- */
 
-    // Append all the headers sent by the client EXCEPT for User-agent data,
-    // which is now specific to the proxy
-    while (curHeader != NULL) {
-        char *header_name = curHeader->name;
-        if (strncmp("User-agent", header_name, 10)) {
-            char header_line[MAXLINE] = "";
-            strncat(header_line, header_name, MAXLINE);
-            strncat(header_line, ": ", MAXLINE);
-            strncat(header_line, curHeader->value, MAXLINE);
-            strncat(header_line, "\r\n", MAXLINE);
+    /* Compressed and identity responses are different objects: key them
+     * separately so gzip bytes are never replayed to a client that cannot
+     * decode them */
+    char cache_key[MAXLINE];
+    snprintf(cache_key, MAXLINE, "%s%s", uri, client_gzip ? "#gzip" : "");
 
-            strncat(request, header_line, MAXLINE);
+    char *cached_data;
+    size_t cached_size;
+    char cached_etag[CACHE_VALIDATOR_MAX];
+    char cached_lastmod[CACHE_VALIDATOR_MAX];
+    PROF_TICK(prof_cache);
+    cache_fetch_result fetch =
+        cache_fetch_begin(cache_key, arena, &cached_data, &cached_size,
+                          cached_etag, cached_lastmod);
+    PROF_STAGE(PROF_CACHE, prof_cache);
+    if (fetch == CACHE_FETCH_HIT) {
+        /* Cache hit: answer from memory without contacting the server.
+         * Under a herd this includes every request that waited while the
+         * first miss fetched the object. A fetch pre-dispatched for this
+         * request was wasted work; its connection cannot be pooled with a
+         * response in flight on it */
+        if (predispatched_fd >= 0) {
+            close(predispatched_fd);
         }
-        curHeader = parser_retrieve_next_header(parser);
-        headers_parsed++;
+        rio_writen(client->connfd, cached_data, cached_size);
+        rs.cache_hit = true;
+        rs.relay_bytes = cached_size;
+        stats_record(&rs);
+        accesslog_record(host, path, 200, cached_size,
+                         stats_now_ns() - t_start, true);
+        return client_keepalive;
     }
+    bool fetch_leader =
+        fetch == CACHE_FETCH_LEADER || fetch == CACHE_FETCH_REVALIDATE;
 
-    if (headers_parsed < 1) {
-        /* Needs at least one header, Malformed request */
-        parser_free(parser);
+    /* A stale copy with validators turns this fetch into a conditional
+     * one, unless the request already went out unconditionally while the
+     * previous response was relaying -- then the full response is simply
+     * taken as the fresh copy */
+    bool revalidating =
+        fetch == CACHE_FETCH_REVALIDATE && predispatched_fd < 0;
+
+    /* --- Forming the request for the server --- */
+    struct iovec req_iov[REQUEST_MAX_IOV];
+    int req_niov = build_origin_iov(&fp, client_gzip,
+                                    revalidating ? cached_etag : NULL,
+                                    revalidating ? cached_lastmod : NULL,
+                                    req_iov);
+    if (req_niov < 0) {
+        if (fetch_leader) {
+            cache_fetch_end(cache_key);
+        }
+        if (predispatched_fd >= 0) {
+            close(predispatched_fd);
+        }
         clienterror(client->connfd, "400", "Bad Request",
                     "Proxy received a malformed request");
-        return NULL;
+        return false;
     }
 
-    // Appending on the User-Agent data specific to the proxy
-    strncat(request, "User-Agent: ", MAXLINE);
-    strncat(request, header_user_agent, MAXLINE);
-    strncat(request, "\r\n", MAXLINE);
-    strncat(request, "\r\n", MAXLINE);
-
     /* --- Forwarding the request to the server --- */
-    int clientfd =
-        open_clientfd(host, port); // Used to communicate with the server
-    if (clientfd < 0) {
-        clienterror(client->connfd, "503", "Service Unavailable",
-                    "Failed to connect to server");
-        parser_free(parser);
-        return NULL;
+    int clientfd; // Used to communicate with the server
+    if (predispatched_fd >= 0) {
+        /* The request went out while the previous response was still
+         * relaying; by now its response may already be on the way */
+        clientfd = predispatched_fd;
+    } else {
+        t_stage = stats_now_ns();
+        PROF_TICK(prof_connect);
+        clientfd = connpool_get(host, port);
+        if (clientfd < 0) {
+            /* An open circuit fails here in microseconds, without burning
+             * a connect timeout on an origin known to be down */
+            if (!breaker_allow(host, port)) {
+                if (fetch_leader) {
+                    cache_fetch_end(cache_key);
+                }
+                clienterror(client->connfd, "503", "Service Unavailable",
+                            "Origin is temporarily unreachable");
+                return false;
+            }
+            clientfd = dnscache_connect(host, port);
+            if (clientfd < 0) {
+                breaker_failure(host, port);
+            } else {
+                breaker_success(host, port);
+            }
+        }
+        rs.connect_ns = stats_now_ns() - t_stage;
+        PROF_STAGE(PROF_CONNECT, prof_connect);
+        if (clientfd < 0) {
+            if (fetch_leader) {
+                cache_fetch_end(cache_key);
+            }
+            clienterror(client->connfd, "503", "Service Unavailable",
+                        "Failed to connect to server");
+            return false;
+        }
+
+        /* Bound every exchange with the origin, so a wedged server cannot
+         * hold this worker past its deadline */
+        timeout_set(clientfd, TIMEOUT_ORIGIN_SECS, TIMEOUT_ORIGIN_SECS);
+
+        /* One writev straight out of the parse buffer: no header byte is
+         * copied into an assembly buffer on the way to the socket */
+        rio_writevn(clientfd, req_iov, req_niov);
     }
+    t_stage = stats_now_ns();
 
-    rio_writen(clientfd, request, strlen(request));
+    /* If the client pipelined its next request behind this one, start that
+     * fetch before settling in to relay this response */
+    pipeline_predispatch(client_rio, pl);
 
+    /* The whole-request deadline: however steadily bytes trickle, the
+     * relay gives up once this passes and the connection is torn down */
+    uint64_t deadline =
+        stats_now_ns() + (uint64_t)TIMEOUT_REQUEST_SECS * 1000000000ull;
+
+    /* Buffer the origin side through a large arena-backed buffer sized for
+     * bulk relaying; header lines are still read through it line by line */
     rio_t server_rio;
-    rio_readinitb(&server_rio, clientfd);
+    rio_readinitb_sz(&server_rio, clientfd, arena_alloc(arena, RELAY_BUFSIZE),
+                     RELAY_BUFSIZE);
 
     /* --- Reading the response --- */
 
@@ -249,18 +947,345 @@ void *serve(void *vargp) {
      * (Client: client->connfd (file descriptor) + client_rio (rio_t))
      */
 
-    char server_response[MAXLINE];
-    size_t response_size;
-    while ((response_size = rio_readnb(&server_rio, server_response, MAXLINE)) >
-           0) {
-        rio_writen(client->connfd, server_response, response_size);
+    response_meta meta;
+    char response_headers[MAXBUF];
+    PROF_TICK(prof_headers);
+    ssize_t header_len =
+        read_response_headers(&server_rio, response_headers, &meta);
+    PROF_STAGE(PROF_HEADERS, prof_headers);
+    if (header_len < 0) {
+        if (fetch_leader) {
+            cache_fetch_end(cache_key);
+        }
+        close(clientfd);
+        clienterror(client->connfd, "502", "Bad Gateway",
+                    "Origin sent an invalid response");
+        return false;
+    }
+    rs.first_byte_ns = stats_now_ns() - t_stage;
+    PROF_TICK(prof_relay);
+
+    if (revalidating && meta.status == 304) {
+        /* Not modified: the cached bytes are still good, so extend their
+         * lifetime and serve them -- the whole object was revalidated for
+         * the cost of a few hundred header bytes. A 304 carries no body,
+         * so the origin connection is immediately reusable */
+        cache_refresh(cache_key, meta.ttl);
+        bool served = cache_lookup(cache_key, arena, &cached_data,
+                                   &cached_size);
+        cache_fetch_end(cache_key);
+        if (meta.keepalive) {
+            connpool_put(host, port, clientfd);
+        } else {
+            close(clientfd);
+        }
+        if (!served) {
+            /* The entry was evicted while the 304 was in flight */
+            clienterror(client->connfd, "502", "Bad Gateway",
+                        "Origin response was discarded");
+            return false;
+        }
+        rio_writen(client->connfd, cached_data, cached_size);
+        rs.cache_hit = true;
+        rs.relay_bytes = cached_size;
+        stats_record(&rs);
+        accesslog_record(host, path, 200, cached_size,
+                         stats_now_ns() - t_start, true);
+        return client_keepalive;
+    }
+
+    long content_length = meta.content_length;
+    bool chunked = meta.chunked;
+    bool origin_keepalive = meta.keepalive;
+
+    /* Tee the response into a cache-candidate buffer as it is relayed. The
+     * buffer is only allocated while the object can still fit under
+     * MAX_OBJECT_SIZE and is dropped the moment it cannot, so oversized
+     * transfers stop paying for accumulation as soon as that is known */
+    char *object_buf = NULL;
+    size_t object_size = 0;
+    bool object_too_big = false;
+
+    /* Only framed (Content-Length) bodies are cache candidates: a chunked
+     * body is not stored verbatim, and an unframed one could never be
+     * replayed on a kept-alive connection -- the replayed bytes carry no
+     * way to tell the client where they end */
+    if (!chunked && content_length >= 0 && meta.status == 200 &&
+        !meta.no_store && meta.ttl > 0 &&
+        (size_t)header_len + (size_t)content_length <= MAX_OBJECT_SIZE) {
+        object_buf = arena_alloc(arena, MAX_OBJECT_SIZE);
+        memcpy(object_buf, response_headers, (size_t)header_len);
+        object_size = (size_t)header_len;
+    } else {
+        /* Known uncacheable before a single body byte: never accumulate */
+        object_too_big = true;
+    }
+
+    char *relay_chunk = arena_alloc(arena, RELAY_BUFSIZE);
+    ssize_t response_size;
+
+    /* Read whatever body bytes are already available so the headers and the
+     * body's first chunk reach the client in a single vectored write
+     * instead of two syscalls */
+    size_t first_want = RELAY_BUFSIZE;
+    if (content_length >= 0 && (size_t)content_length < first_want) {
+        first_want = (size_t)content_length;
+    }
+    if (chunked) {
+        /* Chunked bodies are framed line by line below instead */
+        first_want = 0;
     }
+    ssize_t first_chunk = 0;
+    if (first_want > 0) {
+        first_chunk = rio_readsomeb(&server_rio, relay_chunk, first_want);
+        if (first_chunk < 0) {
+            first_chunk = 0;
+        }
+    }
+
+    struct iovec iov[2];
+    iov[0].iov_base = response_headers;
+    iov[0].iov_len = (size_t)header_len;
+    iov[1].iov_base = relay_chunk;
+    iov[1].iov_len = (size_t)first_chunk;
+    rio_writevn(client->connfd, iov, first_chunk > 0 ? 2 : 1);
+    rs.relay_bytes += (size_t)header_len + (size_t)first_chunk;
+
+    if (first_chunk > 0) {
+        if (!object_too_big &&
+            object_size + (size_t)first_chunk <= MAX_OBJECT_SIZE) {
+            memcpy(object_buf + object_size, relay_chunk,
+                   (size_t)first_chunk);
+            object_size += (size_t)first_chunk;
+        } else {
+            /* The arena reclaims the buffer at end of request */
+            object_too_big = true;
+            object_buf = NULL;
+        }
+    }
+
+    /* The origin connection can only be reused if we know exactly where
+     * this response ends */
+    bool origin_reusable = origin_keepalive && (content_length >= 0 || chunked);
+
+    /* A body this large would pin this worker for minutes while small
+     * requests queue behind it; hand both sockets to the bulk engine,
+     * which moves it forward in bounded quanta round-robin with the other
+     * elephant flows, and return this worker to the pool. rio_readsomeb
+     * left the origin buffer drained, so the raw descriptor is at the
+     * next body byte */
+    if (!chunked && content_length >= 0 &&
+        content_length - first_chunk > BULK_THRESHOLD &&
+        bulk_submit(clientfd, client->connfd, content_length - first_chunk,
+                    deadline)) {
+        if (fetch_leader) {
+            cache_fetch_end(cache_key);
+        }
+        stats_record(&rs);
+        accesslog_record(host, path, meta.status, rs.relay_bytes,
+                         stats_now_ns() - t_start, false);
+        client->connfd = -1; /* The engine owns and closes both sockets */
+        return false;
+    }
+
+    if (chunked) {
+        /* Chunked body: follow the chunk framing to its terminator, so the
+         * origin socket is reusable the moment the trailer ends */
+        if (!relay_chunked(&server_rio, client->connfd, &rs, deadline)) {
+            origin_reusable = false;
+            client_keepalive = false;
+        }
+    } else if (content_length >= 0) {
+        /* Framed body: read exactly Content-Length bytes */
+        long remaining = content_length - first_chunk;
+        while (remaining > 0) {
+            size_t chunk = remaining < (long)RELAY_BUFSIZE
+                               ? (size_t)remaining
+                               : (size_t)RELAY_BUFSIZE;
+            response_size = rio_readsomeb(&server_rio, relay_chunk, chunk);
+            if (response_size <= 0) {
+                break;
+            }
+            rio_writen(client->connfd, relay_chunk, (size_t)response_size);
+            rs.relay_bytes += (size_t)response_size;
+            if (!object_too_big &&
+                object_size + (size_t)response_size <= MAX_OBJECT_SIZE) {
+                memcpy(object_buf + object_size, relay_chunk,
+                       (size_t)response_size);
+                object_size += (size_t)response_size;
+            } else if (object_buf != NULL) {
+                /* The arena reclaims the buffer at end of request */
+                object_too_big = true;
+                object_buf = NULL;
+            }
+            remaining -= response_size;
+            if (stats_now_ns() > deadline) {
+                break; /* Evicted: the request deadline passed */
+            }
+        }
+        if (remaining > 0) {
+            /* Short response: both connections are out of sync with the
+             * framing they advertised */
+            origin_reusable = false;
+            client_keepalive = false;
+        }
+    } else {
+        /* Unframed body: the origin signals the end of the response by
+         * closing, and the client has to be told the same way (RFC 7230
+         * section 3.3.3), so this connection cannot be kept alive and
+         * the payload never needs to be inspected. rio_readsomeb left
+         * the internal buffer drained, so the remainder can be handed
+         * straight off: the bulk engine takes it if a slot is free,
+         * releasing this worker; otherwise the zero-copy relay finishes
+         * it here */
+        client_keepalive = false;
+        if (bulk_submit(clientfd, client->connfd, -1, deadline)) {
+            if (fetch_leader) {
+                cache_fetch_end(cache_key);
+            }
+            stats_record(&rs);
+            accesslog_record(host, path, meta.status, rs.relay_bytes,
+                             stats_now_ns() - t_start, false);
+            client->connfd = -1;
+            return false;
+        }
+        ssize_t spliced = relay_splice(clientfd, client->connfd, deadline);
+        if (spliced > 0) {
+            rs.relay_bytes += (size_t)spliced;
+        }
+    }
+
+    if (!object_too_big && object_buf != NULL) {
+        cache_insert(cache_key, object_buf, object_size, meta.ttl, meta.etag,
+                     meta.last_modified);
+    }
+    if (fetch_leader) {
+        /* Wake anything that coalesced onto this fetch */
+        cache_fetch_end(cache_key);
+    }
+
+    if (origin_reusable) {
+        connpool_put(host, port, clientfd);
+    } else {
+        close(clientfd);
+    }
+    PROF_STAGE(PROF_RELAY, prof_relay);
+    stats_record(&rs);
+    accesslog_record(host, path, meta.status, rs.relay_bytes,
+                     stats_now_ns() - t_start, false);
+    return client_keepalive;
+}
+
+/*
+ * @brief Serves a client connection until it is done issuing requests
+ *
+ * The caller owns the connection: it is closed and the client_info
+ * recycled by the worker loop after this function returns, on every path.
+ *
+ * param[in] client: the details of the client to be served
+ * param[in] arena: the worker's request arena
+ */
+void serve(client_info *client, arena_t *arena) {
+    rio_t client_rio;
+    rio_readinitb(&client_rio, client->connfd);
+
+    /* Pipeline state for this connection: a pre-read next head and any
+     * origin fetch dispatched for it ahead of its turn */
+    pipeline_t pl;
+    pl.have_head = false;
+    pl.dispatched = false;
+
+    /* A client that never delivers its request head, or stops reading our
+     * writes, forfeits this worker after a bounded wait instead of pinning
+     * it forever */
+    timeout_set(client->connfd, TIMEOUT_HEADER_SECS, TIMEOUT_WRITE_SECS);
 
-    close(client->connfd);
-    Free(vargp);
-    parser_free(parser);
+    /* Keep answering requests on this connection until the client signals
+     * close, sends no further request, or an error ends the exchange. The
+     * arena is reset between requests, releasing everything each one
+     * allocated in a single pointer bump */
+    while (serve_request(client, &client_rio, arena, &pl)) {
+        arena_reset(arena);
+        /* Between requests a kept-alive client may idle longer than a
+         * partial head is allowed to dribble in */
+        timeout_set(client->connfd, TIMEOUT_IDLE_SECS, TIMEOUT_WRITE_SECS);
+    }
+    arena_reset(arena);
+
+    /* A fetch dispatched for a request that will never be served now */
+    if (pl.dispatched) {
+        close(pl.originfd);
+    }
+}
+
+/*
+ * @brief The loop ran by each worker thread in the pool
+ *
+ * Workers block on the connection queue, serve each connection they pull off
+ * it, and handle the cleanup that every path through serve relies on.
+ *
+ * param[in] vargp: unused
+ * return: never returns
+ */
+void *worker(void *vargp) {
+    (void)vargp;
+    arena_t arena;
+    arena_init(&arena, WORKER_ARENA_CAP);
+    while (true) {
+        client_info *client = sbuf_remove(&conn_queue);
+        serve(client, &arena);
+        if (client->connfd >= 0) {
+            /* -1 means the connection was handed to the bulk engine */
+            close(client->connfd);
+        }
+        client_info_release(client);
+    }
     return NULL;
 }
+
+/*
+ * @brief The accept loop ran by each listener shard
+ *
+ * Accepts connections on this shard's listening socket and queues them for
+ * the worker pool, blocking for back-pressure when the queue is full.
+ *
+ * param[in] vargp: the shard's listening descriptor, cast through intptr_t
+ * return: never returns
+ */
+static void *acceptor(void *vargp) {
+    int listenfd = (int)(intptr_t)vargp;
+
+    while (true) {
+        client_info *client = client_info_acquire();
+
+        client->addrlen = sizeof(client->addr);
+
+        client->connfd = accept(listenfd, &client->addr, &client->addrlen);
+        if (client->connfd < 0) {
+            perror("accept");
+            client_info_release(client);
+            continue;
+        }
+
+        /* Admission control: past the watermark the proxy is already at
+         * capacity, and queueing more work would only make every request
+         * slower together. Shed the connection with an immediate 503 --
+         * some requests failing fast beats all requests timing out */
+        if (sbuf_level(&conn_queue) >= admission_limit) {
+            clienterror(client->connfd, "503", "Service Unavailable",
+                        "Proxy is over capacity, try again shortly");
+            close(client->connfd);
+            client_info_release(client);
+            continue;
+        }
+
+        /* Queueing an individual client for the pool; blocks for
+         * back-pressure when all slots are full */
+        sbuf_insert(&conn_queue, client);
+    }
+    return NULL;
+}
+
 /*
  * @brief The main function used by the proxy program
  *
@@ -268,6 +1293,57 @@ void *serve(void *vargp) {
  *
  */
 
+/*
+ * @brief Forks the worker processes for prefork mode and supervises them
+ *
+ * Each child returns from here and runs the full accept/serve machinery
+ * on its own SO_REUSEPORT listeners. The parent stays inside forever:
+ * it respawns any child that dies on a signal, so a crash in one process
+ * never takes down the rest, and exits only when a child exits cleanly,
+ * which signals a configuration error worth surfacing instead of a
+ * respawn loop.
+ *
+ * param[in] nprocs: how many worker processes to keep alive
+ * return: only in a child process (or inline if fork fails entirely)
+ */
+static void prefork_supervise(long nprocs) {
+    for (long i = 0; i < nprocs; i++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            return; /* The child proceeds as a worker process */
+        }
+        if (pid < 0) {
+            perror("fork");
+            if (i == 0) {
+                return; /* No children at all: run inline instead */
+            }
+            break;
+        }
+    }
+
+    while (true) {
+        int status;
+        pid_t died = wait(&status);
+        if (died < 0) {
+            return; /* No children left to supervise */
+        }
+        if (WIFSIGNALED(status)) {
+            fprintf(stderr,
+                    "proxy: worker process %d died on signal %d, "
+                    "respawning\n",
+                    (int)died, WTERMSIG(status));
+            pid_t pid = fork();
+            if (pid == 0) {
+                return;
+            }
+        } else {
+            /* A clean exit means the child could not start (bad port,
+             * for instance); retrying would just loop */
+            exit(WEXITSTATUS(status));
+        }
+    }
+}
+
 int main(int argc, char **argv) {
     /* --- Setting up the Proxy --- */
     sigset_t mask;
@@ -276,30 +1352,123 @@ int main(int argc, char **argv) {
     sigaddset(&mask, SIGPIPE);
     sigprocmask(SIG_BLOCK, &mask, NULL);
 
-    dbg_assert(argc == 2);
+    /* -e selects the single-process event loop instead of the pool;
+     * -p N preforks N worker processes that each run the full pool */
+    bool event_mode = false;
+    long nprocs = 1;
+    int opt;
+    while ((opt = getopt(argc, argv, "ep:")) != -1) {
+        switch (opt) {
+        case 'e':
+            event_mode = true;
+            break;
+        case 'p':
+            nprocs = atol(optarg);
+            if (nprocs < 1) {
+                nprocs = 1;
+            }
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-e] [-p nprocs] <port>\n", argv[0]);
+            return 1;
+        }
+    }
+    dbg_assert(optind == argc - 1);
+
+    /* The cache is mapped before any forking: on a fresh cache file the
+     * first process to see an invalid magic lays out the shard headers,
+     * and that must happen exactly once, in the parent, rather than as a
+     * race between N children resetting the same live region */
+    cache_init();
+
+    /* Prefork scale-out: one process tops out on allocator and kernel
+     * contention however well it threads, so -p forks the whole machinery
+     * N ways before anything else is set up. Each child binds its own
+     * SO_REUSEPORT listeners (the kernel spreads connections across
+     * processes exactly as it does across this process's acceptor
+     * shards), and because the object cache above is a memory-mapped
+     * file with process-shared robust locks, every child inherits the
+     * same mapping: hit rates do not fragment N ways, and a crashed
+     * child neither corrupts it nor outlives supervision */
+    if (nprocs > 1 && !event_mode) {
+        prefork_supervise(nprocs);
+    }
+
+    breaker_init();
+    connpool_init();
+    dnscache_init();
+    stats_init();
+    accesslog_init();
+    bulk_init();
+    profile_init();
 
-    char *listening_port = argv[1];
-    int listenfd;
+    /* The shed watermark may be tuned (or effectively disabled with a
+     * large value) without a rebuild */
+    const char *max_queued = getenv("PROXY_MAX_QUEUED");
+    if (max_queued != NULL && atol(max_queued) > 0) {
+        admission_limit = (size_t)atol(max_queued);
+        if (admission_limit > CONN_QUEUE_SLOTS) {
+            admission_limit = CONN_QUEUE_SLOTS;
+        }
+    }
+
+    char *listening_port = argv[optind];
     pthread_t tid;
 
-    listenfd = open_listenfd(listening_port);
-    if (listenfd < 0) {
-        fprintf(stderr, "Failed to listen on port: %s\n", argv[1]);
+    if (event_mode) {
+        /* Serve everything from one event-driven thread */
+        int listenfd = open_listenfd(listening_port);
+        if (listenfd < 0) {
+            fprintf(stderr, "Failed to listen on port: %s\n", listening_port);
+            return 1;
+        }
+        event_loop(listenfd);
+        return 1; /* event_loop only returns on unrecoverable errors */
     }
 
-    /* --- Handling Requests ---*/
-    while (true) {
-        client_info *client = Malloc(sizeof(client_info));
+    /* --- Spawning the worker pool --- */
+    sbuf_init(&conn_queue, CONN_QUEUE_SLOTS);
+    long nworkers = sysconf(_SC_NPROCESSORS_ONLN);
+    if (nworkers < 1) {
+        nworkers = FALLBACK_NWORKERS;
+    }
+    if (nprocs > 1) {
+        /* The pool is split across the worker processes rather than
+         * oversubscribing every core N times over */
+        nworkers = nworkers / nprocs > 0 ? nworkers / nprocs : 1;
+    }
+    for (long i = 0; i < nworkers; i++) {
+        pthread_create(&tid, NULL, worker, NULL);
+        pthread_detach(tid);
+    }
 
-        client->addrlen = sizeof(client->addr);
+    /* --- Handling Requests ---*/
 
-        client->connfd = accept(listenfd, &client->addr, &client->addrlen);
-        if (client->connfd < 0) {
-            perror("accept");
-            continue;
+    /* Shard the listener across up to MAX_ACCEPT_SHARDS acceptor threads,
+     * each with its own SO_REUSEPORT socket on the listening port, so no
+     * single accept queue or acceptor thread bottlenecks a connection
+     * burst. If the kernel refuses extra shards we run with however many
+     * bound successfully */
+    long nshards = nworkers < MAX_ACCEPT_SHARDS ? nworkers : MAX_ACCEPT_SHARDS;
+    int shardfds[MAX_ACCEPT_SHARDS];
+    long nbound = 0;
+    for (long i = 0; i < nshards; i++) {
+        int fd = open_listenfd_reuseport(listening_port);
+        if (fd < 0) {
+            break;
         }
+        shardfds[nbound++] = fd;
+    }
+    if (nbound == 0) {
+        fprintf(stderr, "Failed to listen on port: %s\n", listening_port);
+        return 1;
+    }
 
-        /* Serving an individual client */
-        pthread_create(&tid, NULL, serve, client);
+    for (long i = 1; i < nbound; i++) {
+        pthread_create(&tid, NULL, acceptor, (void *)(intptr_t)shardfds[i]);
+        pthread_detach(tid);
     }
+
+    /* The main thread serves as the first shard's acceptor */
+    acceptor((void *)(intptr_t)shardfds[0]);
 }
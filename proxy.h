@@ -0,0 +1,32 @@
+/**
+ * @file proxy.h
+ * @brief Declarations shared between the proxy's serving modes
+ *
+ * The proxy can serve clients either from the threaded worker pool in
+ * proxy.c or from the single-process event loop in event.c. The pieces of
+ * request handling that both modes need are declared here.
+ */
+
+#ifndef PROXY_H
+#define PROXY_H
+
+/* String to use for the User-Agent header, terminated with \r\n by users */
+extern const char *header_user_agent;
+
+/**
+ * @brief Send an HTTP error response to a client
+ *
+ * Builds and writes a small HTML error page. Any failure to write is
+ * reported on stderr and otherwise ignored, since the client is about to be
+ * dropped anyway.
+ *
+ * @param[in] fd The client file descriptor to send the error to
+ * @param[in] errnum The status code as a string (eg. 404)
+ * @param[in] shortmsg The short error message to be delivered
+ * @param[in] longmsg The long error message to be delivered. Often a more
+ * detailed explanation of the error or why it occured
+ */
+void clienterror(int fd, const char *errnum, const char *shortmsg,
+                 const char *longmsg);
+
+#endif /* PROXY_H */
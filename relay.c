@@ -0,0 +1,197 @@
+/*
+ * This file implements the zero-copy relay declared in relay.h. splice(2)
+ * cannot move bytes directly between two sockets, so each call sets up a
+ * pipe and bounces the payload off it: socket -> pipe and pipe -> socket are
+ * both in-kernel moves, and no payload byte ever crosses into user space.
+ *
+ * splice is Linux-specific, which is why this file (alone) defines
+ * _GNU_SOURCE before its includes.
+ */
+
+#define _GNU_SOURCE
+
+#include "relay.h"
+#include "csapp.h"
+#include "stats.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <unistd.h>
+
+/* How many bytes to move per splice call */
+#define SPLICE_CHUNK (256 * 1024)
+
+/*
+ * @brief Relay from infd to outfd with a plain read/write loop
+ *
+ * The fallback for descriptors splice cannot handle.
+ *
+ * param[in] infd: the descriptor to read from
+ * param[in] outfd: the descriptor to write to
+ * return: the number of bytes relayed, or -1 on error
+ */
+static ssize_t relay_copy(int infd, int outfd, uint64_t deadline) {
+    char buf[MAXBUF];
+    ssize_t total = 0;
+    ssize_t n;
+    while ((n = read(infd, buf, sizeof(buf))) > 0) {
+        if (rio_writen(outfd, buf, (size_t)n) < 0) {
+            return -1;
+        }
+        total += n;
+        if (stats_now_ns() > deadline) {
+            return -1; /* Evicted: the request deadline passed */
+        }
+    }
+    return n < 0 ? -1 : total;
+}
+
+/*
+ * @brief Relay at most max bytes with a plain read/write loop
+ *
+ * The bounded fallback for descriptors splice cannot handle.
+ *
+ * param[in] infd: the descriptor to read from
+ * param[in] outfd: the descriptor to write to
+ * param[in] max: the most bytes to move
+ * return: the number of bytes relayed, 0 on EOF, or -1 on error
+ */
+static ssize_t relay_copy_some(int infd, int outfd, size_t max) {
+    char buf[MAXBUF];
+    ssize_t total = 0;
+    while ((size_t)total < max) {
+        size_t want = max - (size_t)total;
+        if (want > sizeof(buf)) {
+            want = sizeof(buf);
+        }
+        ssize_t n = read(infd, buf, want);
+        if (n == 0) {
+            return total;
+        }
+        if (n < 0 || rio_writen(outfd, buf, (size_t)n) < 0) {
+            return total > 0 ? total : -1;
+        }
+        total += n;
+    }
+    return total;
+}
+
+ssize_t relay_splice_some(int infd, int outfd, size_t max) {
+    int pipefd[2];
+    if (pipe(pipefd) < 0) {
+        return relay_copy_some(infd, outfd, max);
+    }
+
+    ssize_t total = 0;
+    ssize_t result = -1;
+
+    while ((size_t)total < max) {
+        size_t want = max - (size_t)total;
+        if (want > SPLICE_CHUNK) {
+            want = SPLICE_CHUNK;
+        }
+
+        /* Socket -> pipe */
+        ssize_t moved = splice(infd, NULL, pipefd[1], NULL, want,
+                               SPLICE_F_MOVE);
+        if (moved < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if ((errno == EINVAL || errno == ENOSYS) && total == 0) {
+                /* splice unusable on these descriptors: fall back */
+                close(pipefd[0]);
+                close(pipefd[1]);
+                return relay_copy_some(infd, outfd, max);
+            }
+            /* A partial quantum is progress; the error resurfaces on the
+             * next call if it persists */
+            result = total > 0 ? total : -1;
+            goto done;
+        }
+        if (moved == 0) {
+            /* EOF from the origin */
+            result = total;
+            goto done;
+        }
+
+        /* Pipe -> socket, draining everything just buffered */
+        ssize_t left = moved;
+        while (left > 0) {
+            ssize_t out = splice(pipefd[0], NULL, outfd, NULL, (size_t)left,
+                                 SPLICE_F_MOVE);
+            if (out < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                goto done;
+            }
+            left -= out;
+            total += out;
+        }
+    }
+    result = total;
+
+done:
+    close(pipefd[0]);
+    close(pipefd[1]);
+    return result;
+}
+
+ssize_t relay_splice(int infd, int outfd, uint64_t deadline) {
+    int pipefd[2];
+    if (pipe(pipefd) < 0) {
+        return relay_copy(infd, outfd, deadline);
+    }
+
+    ssize_t total = 0;
+    ssize_t result = -1;
+
+    while (true) {
+        if (stats_now_ns() > deadline) {
+            break; /* Evicted: the request deadline passed */
+        }
+        /* Socket -> pipe */
+        ssize_t moved =
+            splice(infd, NULL, pipefd[1], NULL, SPLICE_CHUNK, SPLICE_F_MOVE);
+        if (moved < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if ((errno == EINVAL || errno == ENOSYS) && total == 0) {
+                /* splice unusable on these descriptors: fall back */
+                close(pipefd[0]);
+                close(pipefd[1]);
+                return relay_copy(infd, outfd, deadline);
+            }
+            break;
+        }
+        if (moved == 0) {
+            /* EOF from the origin */
+            result = total;
+            break;
+        }
+
+        /* Pipe -> socket, draining everything just buffered */
+        ssize_t left = moved;
+        while (left > 0) {
+            ssize_t out =
+                splice(pipefd[0], NULL, outfd, NULL, (size_t)left,
+                       SPLICE_F_MOVE);
+            if (out < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                goto done;
+            }
+            left -= out;
+            total += out;
+        }
+    }
+
+done:
+    close(pipefd[0]);
+    close(pipefd[1]);
+    return result;
+}
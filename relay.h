@@ -0,0 +1,54 @@
+/**
+ * @file relay.h
+ * @brief Interface for the zero-copy response relay
+ *
+ * The ordinary relay loop copies every payload byte kernel -> user -> kernel
+ * through an 8 KiB buffer. For responses that no longer need to be seen in
+ * user space (in particular, responses already known to be too large to
+ * cache), the bytes can instead be moved between the two sockets entirely in
+ * the kernel with splice(2) through a pipe, which removes both copies from
+ * the relay cost of large transfers.
+ */
+
+#ifndef RELAY_H
+#define RELAY_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+/**
+ * @brief Relay bytes from one socket to another without copying to user space
+ *
+ * Moves bytes from infd to outfd through a pipe using splice(2) until infd
+ * reaches EOF or the deadline passes. If splice is not usable on these
+ * descriptors, falls back to a plain read/write loop, so callers can treat
+ * this as a drop-in replacement for a buffer relay whose payload they do not
+ * need to inspect.
+ *
+ * @param[in] infd The descriptor to read from (e.g. the origin socket)
+ * @param[in] outfd The descriptor to write to (e.g. the client socket)
+ * @param[in] deadline When to give up, in stats_now_ns() terms, so a
+ * trickling transfer honors the whole-request deadline
+ *
+ * @return The number of bytes relayed, or -1 on error or deadline eviction
+ */
+ssize_t relay_splice(int infd, int outfd, uint64_t deadline);
+
+/**
+ * @brief Relay at most max bytes from one socket to another in the kernel
+ *
+ * The bounded sibling of relay_splice(), for callers that interleave many
+ * transfers and move each forward a quantum at a time. Moves up to max
+ * bytes through a pipe using splice(2), falling back to a plain
+ * read/write loop if splice is not usable on these descriptors. Blocking
+ * behavior follows the sockets' own SO_RCVTIMEO / SO_SNDTIMEO deadlines.
+ *
+ * @param[in] infd The descriptor to read from (e.g. the origin socket)
+ * @param[in] outfd The descriptor to write to (e.g. the client socket)
+ * @param[in] max The most bytes to move before returning
+ *
+ * @return The number of bytes relayed, 0 on EOF from infd, or -1 on error
+ */
+ssize_t relay_splice_some(int infd, int outfd, size_t max);
+
+#endif /* RELAY_H */
@@ -0,0 +1,57 @@
+/*
+ * This file implements the bounded producer/consumer queue declared in
+ * sbuf.h as a ring buffer guarded by a mutex, with two condition variables
+ * so that producers and consumers only wake each other when the state they
+ * are waiting for has actually changed.
+ */
+
+#include "sbuf.h"
+#include "csapp.h"
+
+void sbuf_init(sbuf_t *sp, size_t n) {
+    sp->buf = Calloc(n, sizeof(void *));
+    sp->n = n;
+    sp->front = 0;
+    sp->count = 0;
+    pthread_mutex_init(&sp->mutex, NULL);
+    pthread_cond_init(&sp->not_empty, NULL);
+    pthread_cond_init(&sp->not_full, NULL);
+}
+
+void sbuf_deinit(sbuf_t *sp) {
+    pthread_mutex_destroy(&sp->mutex);
+    pthread_cond_destroy(&sp->not_empty);
+    pthread_cond_destroy(&sp->not_full);
+    Free(sp->buf);
+}
+
+void sbuf_insert(sbuf_t *sp, void *item) {
+    pthread_mutex_lock(&sp->mutex);
+    while (sp->count == sp->n) {
+        pthread_cond_wait(&sp->not_full, &sp->mutex);
+    }
+    sp->buf[(sp->front + sp->count) % sp->n] = item;
+    sp->count++;
+    pthread_cond_signal(&sp->not_empty);
+    pthread_mutex_unlock(&sp->mutex);
+}
+
+size_t sbuf_level(sbuf_t *sp) {
+    pthread_mutex_lock(&sp->mutex);
+    size_t count = sp->count;
+    pthread_mutex_unlock(&sp->mutex);
+    return count;
+}
+
+void *sbuf_remove(sbuf_t *sp) {
+    pthread_mutex_lock(&sp->mutex);
+    while (sp->count == 0) {
+        pthread_cond_wait(&sp->not_empty, &sp->mutex);
+    }
+    void *item = sp->buf[sp->front];
+    sp->front = (sp->front + 1) % sp->n;
+    sp->count--;
+    pthread_cond_signal(&sp->not_full);
+    pthread_mutex_unlock(&sp->mutex);
+    return item;
+}
@@ -0,0 +1,83 @@
+/**
+ * @file sbuf.h
+ * @brief Interface for a bounded producer/consumer queue
+ *
+ * The queue holds a fixed number of untyped item pointers. Producers calling
+ * sbuf_insert() block while the queue is full, and consumers calling
+ * sbuf_remove() block while it is empty, so a burst of work degrades into
+ * back-pressure on the producer instead of unbounded memory growth.
+ *
+ * All functions other than sbuf_init() and sbuf_deinit() are safe to call
+ * concurrently from multiple threads.
+ */
+
+#ifndef SBUF_H
+#define SBUF_H
+
+#include <pthread.h>
+#include <stddef.h>
+
+/* A bounded queue of item pointers */
+typedef struct {
+    void **buf;                /* Ring buffer of items */
+    size_t n;                  /* Capacity of the ring buffer */
+    size_t front;              /* Index of the next item to remove */
+    size_t count;              /* Number of items currently queued */
+    pthread_mutex_t mutex;     /* Guards all fields */
+    pthread_cond_t not_empty;  /* Signaled when an item is inserted */
+    pthread_cond_t not_full;   /* Signaled when an item is removed */
+} sbuf_t;
+
+/**
+ * @brief Initialize a queue with room for n items
+ *
+ * Must be called before any threads use the queue.
+ *
+ * @param[in] sp The queue to initialize
+ * @param[in] n The maximum number of items the queue can hold
+ */
+void sbuf_init(sbuf_t *sp, size_t n);
+
+/**
+ * @brief Destroy a queue and free its storage
+ *
+ * No threads may be using the queue when this is called.
+ *
+ * @param[in] sp The queue to destroy
+ */
+void sbuf_deinit(sbuf_t *sp);
+
+/**
+ * @brief Insert an item at the tail of the queue
+ *
+ * Blocks until there is room in the queue.
+ *
+ * @param[in] sp The queue
+ * @param[in] item The item to insert
+ */
+void sbuf_insert(sbuf_t *sp, void *item);
+
+/**
+ * @brief Remove and return the item at the head of the queue
+ *
+ * Blocks until an item is available.
+ *
+ * @param[in] sp The queue
+ *
+ * @return The removed item
+ */
+void *sbuf_remove(sbuf_t *sp);
+
+/**
+ * @brief How many items the queue currently holds
+ *
+ * A momentary snapshot: the depth may change the instant the lock is
+ * released, so this is for admission decisions, not exact accounting.
+ *
+ * @param[in] sp The queue
+ *
+ * @return The number of queued items
+ */
+size_t sbuf_level(sbuf_t *sp);
+
+#endif /* SBUF_H */
@@ -0,0 +1,111 @@
+/*
+ * This file implements the per-thread statistics counters declared in
+ * stats.h. Each recording thread claims one slot in a fixed array the first
+ * time it records; a slot is padded to a cache line so two threads never
+ * write to the same line. Recording is then plain (unsynchronized) stores
+ * to the thread's own slot, and stats_format() sums across slots, accepting
+ * that a snapshot taken mid-request may be off by a request.
+ */
+
+#include "stats.h"
+#include "csapp.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+/* The most recording threads supported; extra threads share the last slot,
+ * trading a little cache-line bouncing for never failing */
+#define STATS_MAX_THREADS 128
+
+/* One thread's counters, padded out to its own cache line */
+typedef struct {
+    uint64_t requests;
+    uint64_t cache_hits;
+    uint64_t parse_ns;
+    uint64_t connect_ns;
+    uint64_t first_byte_ns;
+    uint64_t relay_bytes;
+} __attribute__((aligned(64))) stats_slot;
+
+static stats_slot slots[STATS_MAX_THREADS];
+static unsigned next_slot = 0;
+
+/* Index of this thread's slot; -1 until first use */
+static __thread int my_slot = -1;
+
+void stats_init(void) {
+    /* Slots are zeroed static storage; nothing further to set up */
+}
+
+uint64_t stats_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/*
+ * @brief Return the calling thread's slot, claiming one on first use
+ *
+ * return: the thread's counter slot
+ */
+static stats_slot *slot_local(void) {
+    if (my_slot < 0) {
+        unsigned idx = __sync_fetch_and_add(&next_slot, 1);
+        if (idx >= STATS_MAX_THREADS) {
+            idx = STATS_MAX_THREADS - 1;
+        }
+        my_slot = (int)idx;
+    }
+    return &slots[my_slot];
+}
+
+void stats_record(const req_stats *rs) {
+    stats_slot *slot = slot_local();
+    slot->requests++;
+    if (rs->cache_hit) {
+        slot->cache_hits++;
+    }
+    slot->parse_ns += rs->parse_ns;
+    slot->connect_ns += rs->connect_ns;
+    slot->first_byte_ns += rs->first_byte_ns;
+    slot->relay_bytes += rs->relay_bytes;
+}
+
+size_t stats_format(char *buf, size_t len) {
+    stats_slot total;
+    memset(&total, 0, sizeof(total));
+
+    for (int i = 0; i < STATS_MAX_THREADS; i++) {
+        total.requests += slots[i].requests;
+        total.cache_hits += slots[i].cache_hits;
+        total.parse_ns += slots[i].parse_ns;
+        total.connect_ns += slots[i].connect_ns;
+        total.first_byte_ns += slots[i].first_byte_ns;
+        total.relay_bytes += slots[i].relay_bytes;
+    }
+
+    uint64_t misses = total.requests - total.cache_hits;
+    uint64_t n = total.requests > 0 ? total.requests : 1;
+    uint64_t m = misses > 0 ? misses : 1;
+
+    int written = snprintf(
+        buf, len,
+        "requests:        %llu\n"
+        "cache-hits:      %llu\n"
+        "cache-misses:    %llu\n"
+        "relay-bytes:     %llu\n"
+        "avg-parse-us:    %llu\n"
+        "avg-connect-us:  %llu\n"
+        "avg-firstbyte-us: %llu\n",
+        (unsigned long long)total.requests,
+        (unsigned long long)total.cache_hits, (unsigned long long)misses,
+        (unsigned long long)total.relay_bytes,
+        (unsigned long long)(total.parse_ns / n / 1000),
+        (unsigned long long)(total.connect_ns / m / 1000),
+        (unsigned long long)(total.first_byte_ns / m / 1000));
+    if (written < 0) {
+        return 0;
+    }
+    return (size_t)written < len ? (size_t)written : len - 1;
+}
@@ -0,0 +1,72 @@
+/**
+ * @file stats.h
+ * @brief Interface for the proxy's request instrumentation
+ *
+ * Each request records how long its stages took (parsing, origin connect,
+ * origin first byte) and how many bytes it relayed, along with whether it
+ * hit the cache. Counters are aggregated into a per-thread slot so the hot
+ * path never takes a lock or bounces a shared cache line; the slots are only
+ * summed when somebody asks for the totals.
+ *
+ * The aggregate is exposed over HTTP: a request whose path is
+ * STATS_ENDPOINT is answered by the proxy itself with a plain-text summary
+ * instead of being forwarded.
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* The request path the proxy answers locally with its statistics */
+#define STATS_ENDPOINT "/proxy-stats"
+
+/* Everything one request contributes to the counters */
+typedef struct {
+    bool cache_hit;        /* Answered from the cache */
+    uint64_t parse_ns;     /* Reading and parsing the request */
+    uint64_t connect_ns;   /* Dialing (or pooling) the origin */
+    uint64_t first_byte_ns; /* Request sent until response headers arrived */
+    uint64_t relay_bytes;  /* Response bytes written to the client */
+} req_stats;
+
+/**
+ * @brief Initialize the statistics counters
+ *
+ * Must be called once, before any threads that record statistics are
+ * created.
+ */
+void stats_init(void);
+
+/**
+ * @brief Read the monotonic clock
+ *
+ * @return The current time in nanoseconds, for stage timing
+ */
+uint64_t stats_now_ns(void);
+
+/**
+ * @brief Fold one finished request into the calling thread's counters
+ *
+ * Lock-free: only touches the calling thread's own slot.
+ *
+ * @param[in] rs What the request measured
+ */
+void stats_record(const req_stats *rs);
+
+/**
+ * @brief Format the aggregate statistics as a plain-text report
+ *
+ * Sums every thread's slot. The totals are a momentary snapshot; requests
+ * completing during the sum may be partially included.
+ *
+ * @param[out] buf Receives the NUL-terminated report
+ * @param[in] len The size of buf
+ *
+ * @return The length of the report, excluding the NUL
+ */
+size_t stats_format(char *buf, size_t len);
+
+#endif /* STATS_H */
@@ -0,0 +1,22 @@
+/*
+ * This file implements the socket deadline helper declared in timeout.h.
+ * SO_RCVTIMEO and SO_SNDTIMEO bound each individual read and write in the
+ * kernel, which needs no timer bookkeeping of our own and works unchanged
+ * under the blocking RIO calls the workers use.
+ */
+
+#include "timeout.h"
+
+#include <sys/socket.h>
+#include <sys/time.h>
+
+void timeout_set(int fd, int recv_secs, int send_secs) {
+    struct timeval tv;
+    tv.tv_usec = 0;
+
+    tv.tv_sec = recv_secs;
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    tv.tv_sec = send_secs;
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+}
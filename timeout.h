@@ -0,0 +1,48 @@
+/**
+ * @file timeout.h
+ * @brief Deadlines that evict stuck and slow connections
+ *
+ * A client that connects and never sends a request, dribbles one in a byte
+ * at a time, or stops reading our writes would otherwise pin a worker
+ * thread forever; a wedged origin would do the same. This module centralizes
+ * the proxy's deadline policy: per-read and per-write socket timeouts
+ * (SO_RCVTIMEO / SO_SNDTIMEO), so any single blocked I/O call returns in
+ * bounded time, plus a whole-request deadline that the relay loops check
+ * between reads so a trickling transfer cannot hold a worker indefinitely.
+ *
+ * When a deadline fires the blocked call fails, the normal error paths
+ * tear the connection down, and the worker returns to the pool.
+ */
+
+#ifndef TIMEOUT_H
+#define TIMEOUT_H
+
+/* Seconds a client may take to deliver a complete request head */
+#define TIMEOUT_HEADER_SECS 10
+
+/* Seconds a kept-alive client may idle before sending its next request */
+#define TIMEOUT_IDLE_SECS 60
+
+/* Seconds any single write to a client may block on a slow reader */
+#define TIMEOUT_WRITE_SECS 30
+
+/* Seconds any single read from or write to an origin may block */
+#define TIMEOUT_ORIGIN_SECS 30
+
+/* Seconds one request may take end to end, however steadily it trickles */
+#define TIMEOUT_REQUEST_SECS 120
+
+/**
+ * @brief Set per-read and per-write timeouts on a socket
+ *
+ * After this, any read blocked for recv_secs or write blocked for
+ * send_secs fails with EWOULDBLOCK instead of waiting forever. A value of
+ * zero leaves that direction unbounded.
+ *
+ * @param[in] fd The socket to bound
+ * @param[in] recv_secs Longest any single read may block, in seconds
+ * @param[in] send_secs Longest any single write may block, in seconds
+ */
+void timeout_set(int fd, int recv_secs, int send_secs);
+
+#endif /* TIMEOUT_H */